@@ -7,6 +7,7 @@
 // Hardware Configuration
 #define MATRIX_ROWS 4
 #define MATRIX_COLS 6
+#define KEYMAP_COLS (MATRIX_COLS * 2)  // Both halves side by side in the keymap
 #define DEBOUNCE_MS 10  // Increased for better stability
 
 // Network Configuration - AP MODE
@@ -26,13 +27,34 @@
 
 // Feature Configuration
 #define TAPPING_TERM 200
+#define MODTAP_STRATEGY TAP_HOLD_PERMISSIVE_HOLD  // TAP_HOLD_* flags from tap_hold.h
+#define TAP_HOLD_STREAK_TERM 100  // A key pressed within this many ms of the last one is typing
+#define ADAPTIVE_TERM_MIN 120     // Bounds for the learned terms, ms
+#define ADAPTIVE_TERM_MAX 300
+#define TAPPING_TOGGLE 2  // Taps on a TT key that toggle its layer
 #define ONESHOT_TIMEOUT 3000
 #define COMBO_TERM 30
 #define TAP_DANCE_TERM 200
-#define MAX_LAYERS 8
-#define MAX_COMBOS 32
-#define MAX_TAP_DANCE 16
-#define MAX_MODTAP_KEYS 8
+#define MAX_LAYERS 32
+#define MAX_COMBOS 256
+#ifndef MAX_TAP_DANCE
+#define MAX_TAP_DANCE 16   // Up to 256, TD(n) takes an 8-bit index
+#endif
+#define MACRO_STEP_US 1000  // Macro playback - at most one keyboard state per step
+#define DYNAMIC_MACRO_SIZE 512   // RAM arena shared by the dynamic macro slots
+#define DYNAMIC_MACRO_SLOTS 2    // One per DM_RECn/DM_PLYn pair
+#define DYNAMIC_MACRO_TIMING 0   // Record the gaps between keys, 0 plays at full rate
+
+typedef uint32_t layer_state_t;  // One bit per layer, up to MAX_LAYERS
+
+// USB HID Configuration
+#define NKRO_ENABLE 1  // Send the bitmap keyboard report when the host allows it
+
+// Run the per-event code and tables from SRAM instead of XIP flash (set from
+// CMake with -DRAM_HOT_PATH=ON). See lib/utils/hot_path.h.
+#ifndef RAM_HOT_PATH
+#define RAM_HOT_PATH 0
+#endif
 
 // Pin Definitions for Matrix (GPIO pins)
 #define ROW_PINS {2, 3, 4, 5}
@@ -47,14 +69,48 @@
 typedef enum {
     DEVICE_DONGLE = 0,
     DEVICE_LEFT = 1,
-    DEVICE_RIGHT = 2
+    DEVICE_RIGHT = 2,
+    DEVICE_NUMPAD = 3,
+    DEVICE_MACROPAD = 4
 } device_type_t;
 
+// Maximum number of wireless peripherals paired with the dongle
+// (device IDs 1..MAX_PERIPHERALS)
+#define MAX_PERIPHERALS 8
+
+// Feature selection - set from CMake (e.g. -DCOMBO_ENABLE=OFF). A disabled
+// feature's sources, pipeline stage and state are left out of the build and
+// its keycodes do nothing.
+#ifndef MODTAP_ENABLE
+#define MODTAP_ENABLE 1
+#endif
+#ifndef ADAPTIVE_TERM_ENABLE
+#define ADAPTIVE_TERM_ENABLE 1  // Learn a mod-tap term per key from its taps and holds
+#endif
+#ifndef TAPDANCE_ENABLE
+#define TAPDANCE_ENABLE 1
+#endif
+#ifndef ONESHOT_ENABLE
+#define ONESHOT_ENABLE 1
+#endif
+#ifndef COMBO_ENABLE
+#define COMBO_ENABLE 1
+#endif
+#ifndef DYNAMIC_MACRO_ENABLE
+#define DYNAMIC_MACRO_ENABLE 1
+#endif
+
+#if ADAPTIVE_TERM_ENABLE && !MODTAP_ENABLE
+#error "ADAPTIVE_TERM_ENABLE needs MODTAP_ENABLE"
+#endif
+
 // Feature flags
-#define FEATURE_MODTAP    (1 << 0)
-#define FEATURE_LAYERS    (1 << 1)
-#define FEATURE_ONESHOT   (1 << 2)
-#define FEATURE_COMBOS    (1 << 3)
-#define FEATURE_TAPDANCE  (1 << 4)
+#define FEATURE_MODTAP        (1 << 0)
+#define FEATURE_LAYERS        (1 << 1)
+#define FEATURE_ONESHOT       (1 << 2)
+#define FEATURE_COMBOS        (1 << 3)
+#define FEATURE_TAPDANCE      (1 << 4)
+#define FEATURE_DYNAMIC_MACRO (1 << 5)
+#define FEATURE_ADAPTIVE_TERM (1 << 6)
 
 #endif // CONFIG_H
\ No newline at end of file
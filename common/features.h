@@ -5,10 +5,11 @@
 #include <stdbool.h>
 #include "config.h"
 #include "keycodes.h"
+#include "pipeline.h"
 
 // Feature state structure
 typedef struct {
-    uint8_t layer_state;
+    layer_state_t layer_state;
     uint32_t feature_flags;
     bool oneshot_active;
     uint8_t oneshot_layer;
@@ -24,27 +25,22 @@ void layer_off(uint8_t layer);
 void layer_toggle(uint8_t layer);
 void layer_clear(void);
 uint8_t get_highest_layer(void);
-uint8_t get_layer_state(void);
+layer_state_t get_layer_state(void);
 bool process_layer_keycode(uint16_t keycode, bool pressed);
 
-// Mod-tap functions
-bool process_modtap(uint16_t keycode, bool pressed, uint8_t row, uint8_t col);
-void modtap_task(void);
+// Tap-hold functions (mod-tap, tap-toggle and tap dance)
+pipeline_result_t process_tap_hold(key_event_t *event);
 
 // One-shot functions
-bool process_oneshot_layer(uint16_t keycode, bool pressed);
-void oneshot_task(void);
+pipeline_result_t process_oneshot(key_event_t *event);
 uint8_t get_oneshot_layer(void);
+uint8_t get_oneshot_mods(void);
 bool is_oneshot_active(void);
 
 // Combo functions
-bool process_combo(uint16_t keycode, bool pressed);
+pipeline_result_t process_combo(key_event_t *event);
 void init_combos(void);
 
-// Tap dance functions
-bool process_tap_dance(uint16_t keycode, bool pressed, uint8_t row, uint8_t col);
-void tap_dance_task(void);
-
 // Utility functions
 uint32_t get_feature_flags(void);
 uint16_t get_keycode_at(uint8_t layer, uint8_t row, uint8_t col);
@@ -123,6 +123,17 @@ enum keycodes {
 #define TT(n) (0x5400 | (n))      // Tap toggle
 #define OSL(n) (0x5500 | (n))     // One-shot layer
 
+// One-shot modifiers, taking a mask of MOD_* bits
+#define OSM(mods) (0x5700 | (mods))
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_RCTL 0x10
+#define MOD_RSFT 0x20
+#define MOD_RALT 0x40
+#define MOD_RGUI 0x80
+
 // Mod-Tap Keycodes
 #define MT(mod, kc) ((mod) << 8 | (kc))
 #define CTL_T(kc) MT(KC_LCTL, kc)
@@ -150,6 +161,19 @@ enum keycodes {
 #define KC_UNDO  0x7004
 #define KC_REDO  0x7005
 
+// Dynamic macro keycodes - record into a slot, stop, play a slot back
+#define DM_RSTP  0x7006
+#define DM_REC1  0x7007
+#define DM_REC2  0x7008
+#define DM_PLY1  0x7009
+#define DM_PLY2  0x700A
+
+// First keycode free for keymap custom keycodes, clear of the shortcuts above
+#define SAFE_RANGE 0x7010
+
+// Macros from keymap_macros[] (0x7300-0x73FF range)
+#define MACRO(n) (0x7300 | (n))
+
 // Mouse Movement Keycodes (0x7100-0x71FF range)
 #define KC_MS_UP    0x7100
 #define KC_MS_DOWN  0x7101
@@ -26,7 +26,6 @@ typedef struct {
     bool active;
     uint8_t button;  // Which button to auto-click
     uint32_t interval_ms;
-    uint32_t last_click_time;
     bool click_state;  // true = pressed, false = released
 } autoclicker_state_t;
 
@@ -45,7 +44,6 @@ void mouse_clear(void);
 
 // Auto-clicker functions
 void autoclicker_init(void);
-void autoclicker_task(void);
 void autoclicker_toggle(void);
 void autoclicker_start(uint8_t button);
 void autoclicker_stop(void);
@@ -33,12 +33,18 @@ typedef struct __attribute__((packed)) {
     uint8_t led_state;
 } feature_sync_t;
 
+// Heartbeat payload. boot_id is drawn once per power-up, so a change tells
+// the dongle the peripheral rebooted and its sequence count started over.
+typedef struct __attribute__((packed)) {
+    uint32_t boot_id;
+} heartbeat_t;
+
 // Main Packet Structure
 typedef struct __attribute__((packed)) {
     uint8_t type;
     uint8_t device_id;
     uint16_t sequence;
-    uint32_t timestamp;
+    uint32_t timestamp;  // Sender timer_read_us()
     uint8_t data[32];
     uint16_t checksum;
 } keyboard_packet_t;
@@ -7,9 +7,27 @@
 #include <stdbool.h>
 #include "keycodes.h"
 
+// HID interfaces (TinyUSB instance numbers), each with its own endpoint
+#define HID_ITF_KEYBOARD 0
+#define HID_ITF_MOUSE    1
+
+// Keyboard interface report IDs - the mouse interface carries a single
+// report without an ID
+#define REPORT_ID_KEYBOARD 1  // 6KRO boot-compatible keyboard report
+#define REPORT_ID_NKRO     3  // Bitmap keyboard report
+
+// NKRO bitmap covers HID usages 0x00-0xDF, modifiers are sent separately
+#define NKRO_REPORT_BYTES 28
+#define NKRO_REPORT_KEYS  (NKRO_REPORT_BYTES * 8)
+
 // Initialize USB HID
 void usb_hid_init(void);
 
+// NKRO control - falls back to the 6KRO report while the host has selected
+// the boot protocol
+void set_nkro_enabled(bool enabled);
+bool is_nkro_active(void);
+
 // Key registration functions
 void register_key(uint16_t keycode);
 void unregister_key(uint16_t keycode);
@@ -20,9 +38,30 @@ void unregister_modifier(uint8_t mod);
 void add_key_to_report(uint16_t keycode);    // Alias for register_key
 void remove_key_from_report(uint16_t keycode); // Alias for unregister_key
 
-// HID report management
+// HID report management - every state change is queued and send_hid_report()
+// submits the oldest queued report whenever the endpoint is free
+typedef struct {
+    uint32_t queued;     // Distinct states queued
+    uint32_t sent;       // Reports accepted by the USB stack
+    uint32_t overflows;  // States folded into the newest entry on a full queue
+    uint8_t depth_max;
+} hid_report_stats_t;
+
 void send_hid_report(void);
 void clear_keyboard(void);
+bool hid_report_queue_empty(void);  // Every queued state has been submitted
+const hid_report_stats_t *get_hid_report_stats(void);
+
+// Report latency - submission to the host's IN token completing the
+// transfer. The spread (max - min) is the jitter added by polling.
+typedef struct {
+    uint32_t completions;
+    uint32_t latency_us_min;
+    uint32_t latency_us_max;
+    uint32_t latency_us_total;
+} hid_latency_stats_t;
+
+const hid_latency_stats_t *get_hid_latency_stats(void);
 
 // Utility functions
 uint8_t qmk_to_hid(uint16_t keycode);
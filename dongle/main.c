@@ -16,26 +16,49 @@
 #include "usb_hid.h"
 #include "mouse.h"
 #include "timer.h"
+#include "replay_window.h"
+#include "deadline.h"
+#include "peripherals.h"
+#include "pipeline.h"
+#include "macro.h"
+#include "dynamic_macro.h"
+#include "adaptive_term.h"
+
+// Deferred RX queue - the lwIP callback only validates and enqueues pbuf
+// references, packets are parsed in place and processed from the main loop
+#define RX_QUEUE_SIZE 16  // Must be a power of two
+#define RX_QUEUE_MASK (RX_QUEUE_SIZE - 1)
+
+typedef struct {
+    struct pbuf *slots[RX_QUEUE_SIZE];
+    volatile uint8_t head;  // Next slot to process (main loop)
+    volatile uint8_t tail;  // Next slot to fill (udp_recv_callback)
+} rx_queue_t;
 
-// State Management
 typedef struct {
-    matrix_state_t left_matrix;
-    matrix_state_t right_matrix;
-    uint32_t left_last_seen;
-    uint32_t right_last_seen;
-    uint16_t left_last_sequence;
-    uint16_t right_last_sequence;
-    bool left_connected;
-    bool right_connected;
-} dongle_state_t;
+    uint32_t enqueued;
+    uint32_t processed;
+    uint32_t dropped_full;
+    uint32_t dropped_invalid;
+    uint32_t stale;  // Matrix updates far behind the window, left unacknowledged
+    uint8_t depth_max;
+    uint32_t callback_us_max;
+    uint32_t callback_us_total;
+    uint32_t callback_count;
+} rx_stats_t;
 
-static dongle_state_t state = {0};
 static struct udp_pcb *udp_pcb = NULL;
 static keyboard_packet_t tx_packet;
-static keyboard_packet_t rx_packet;
 static bool wifi_ready = false;
+static rx_queue_t rx_queue = {0};
+static rx_stats_t rx_stats = {0};
+static bool led_flash_active = false;
+static uint32_t led_flash_start = 0;  // Microseconds
 
-extern void process_key_event(uint8_t row, uint8_t col, bool pressed);
+// Linker-defined SRAM regions - .data also holds the RAM_HOT_PATH code
+extern char __data_start__[], __data_end__[];
+extern char __bss_start__[], __bss_end__[];
+extern char __StackLimit[];
 
 uint16_t calculate_checksum(const keyboard_packet_t *packet) {
     uint16_t sum = 0;
@@ -50,113 +73,105 @@ bool validate_packet_checksum(const keyboard_packet_t *packet) {
     return calculate_checksum(packet) == packet->checksum;
 }
 
-static void process_matrix_update(uint8_t device_id, matrix_state_t *matrix) {
-    matrix_state_t *target = (device_id == DEVICE_LEFT) ? 
-                            &state.left_matrix : &state.right_matrix;
+// Release every key still held on a peripheral that stopped responding or
+// rebooted
+static void release_peripheral_keys(peripheral_t *peripheral) {
+    const peripheral_config_t *config = peripheral->config;
     
-    // Process only the CHANGES, not the entire matrix
-    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        uint8_t old_row = target->rows[row];
-        uint8_t new_row = matrix->rows[row];
-        
-        // Use the changed_mask if provided, otherwise calculate it
-        uint8_t changed = matrix->changed_mask[row];
-        if (changed == 0) {
-            changed = old_row ^ new_row;
-        }
-        
-        if (changed == 0) continue; // No changes in this row
-        
-        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-            if (!(changed & (1 << col))) continue; // This key didn't change
-            
-            uint8_t actual_col = (device_id == DEVICE_RIGHT) ? 
-                                col + MATRIX_COLS : col;
-            
-            uint8_t layer = get_highest_layer();
-            uint16_t keycode = get_keycode_at(layer, row, actual_col);
-            
-            bool is_pressed = (new_row & (1 << col)) != 0;
-            bool was_pressed = (old_row & (1 << col)) != 0;
-            
-            // Only process if state actually changed
-            if (is_pressed != was_pressed) {
-                // Process through the feature pipeline first
-                if (!process_combo(keycode, is_pressed)) continue;
-                if (!process_tap_dance(keycode, is_pressed, row, actual_col)) continue;
-                if (!process_modtap(keycode, is_pressed, row, actual_col)) continue;
-                if (!process_layer_keycode(keycode, is_pressed)) continue;
-                if (!process_oneshot_layer(keycode, is_pressed)) continue;
-                
-                // Process mouse keycodes
-                if ((keycode & 0xFF00) == 0x7100) {
-                    process_mouse_keycode(keycode, is_pressed);
-                    continue;
-                }
-                
-                // Process auto-clicker keycodes
-                if ((keycode & 0xFF00) == 0x7200) {
-                    process_autoclicker_keycode(keycode, is_pressed);
-                    continue;
-                }
-                
-                // Handle special keycodes
-                if (keycode == RESET && is_pressed) {
-                    clear_keyboard();
-                    send_hid_report();
-                    continue;
-                }
-                
-                // Finally, handle normal keys
-                if (is_pressed) {
-                    register_key(keycode);
-                } else {
-                    unregister_key(keycode);
-                }
+    for (uint8_t row = 0; row < config->rows; row++) {
+        for (uint8_t col = 0; col < config->cols; col++) {
+            if (peripheral->matrix.rows[row] & (1 << col)) {
+                // Through the pipeline so held layers and mods are released too
+                pipeline_process_key(row, col + config->col_offset, false,
+                                     config->device_id);
             }
         }
-        
-        // Update stored state for this row
-        target->rows[row] = new_row;
     }
     
-    // Send HID report after processing all changes
+    peripheral_reset(peripheral);
     send_hid_report();
-    
-    // Update last seen timestamp
-    uint32_t now = timer_read();
-    if (device_id == DEVICE_LEFT) {
-        state.left_last_seen = now;
-        state.left_connected = true;
-    } else {
-        state.right_last_seen = now;
-        state.right_connected = true;
-    }
 }
 
-static void send_ack_packet(uint8_t device_id, uint16_t sequence) {
+static void send_ack_packet(const peripheral_t *peripheral, uint16_t sequence) {
     if (udp_pcb == NULL) return;
     
     tx_packet.type = PACKET_SYNC_RESPONSE;
     tx_packet.device_id = DEVICE_DONGLE;
     tx_packet.sequence = sequence;
-    tx_packet.timestamp = timer_read();
+    tx_packet.timestamp = timer_read_us();
     tx_packet.checksum = calculate_checksum(&tx_packet);
     
     struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(tx_packet), PBUF_RAM);
     if (p != NULL) {
         memcpy(p->payload, &tx_packet, sizeof(tx_packet));
         
-        // Send ACK back to the appropriate half
-        ip_addr_t target_addr;
-        if (device_id == DEVICE_LEFT) {
-            ipaddr_aton(LEFT_IP, &target_addr);
+        // Send ACK back to the peripheral that sent the update
+        udp_sendto(udp_pcb, p, &peripheral->addr, KB_PORT);
+        pbuf_free(p);
+    }
+}
+
+static void process_packet(const keyboard_packet_t *packet) {
+    peripheral_t *peripheral = peripheral_get(packet->device_id);
+    if (peripheral == NULL) return;  // Unknown device
+    
+    if (packet->type == PACKET_MATRIX_UPDATE) {
+        // Out-of-order packets are applied exactly once, duplicates dropped
+        replay_result_t result = replay_window_check(&peripheral->window, packet->sequence);
+        
+        if (replay_window_accepted(result)) {
+            peripheral_apply_matrix(peripheral,
+                                    (const matrix_state_t *)packet->data,
+                                    packet->sequence,
+                                    result == REPLAY_LATE);
+            
+            // Send HID report after processing all changes
+            send_hid_report();
+            
+            // Brief LED flash for feedback, switched off by the main loop
+            if (!led_flash_active) {
+                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+                led_flash_active = true;
+            }
+            led_flash_start = timer_read_us();
+        }
+        
+        // ACK so the peripheral stops retransmitting, except for a stale
+        // sequence: if the peripheral rebooted, its boot heartbeat restarts
+        // the window and the retransmission is then accepted
+        if (result == REPLAY_STALE) {
+            rx_stats.stale++;
         } else {
-            ipaddr_aton(RIGHT_IP, &target_addr);
+            send_ack_packet(peripheral, packet->sequence);
         }
         
-        udp_sendto(udp_pcb, p, &target_addr, KB_PORT);
+    } else if (packet->type == PACKET_HEARTBEAT) {
+        const heartbeat_t *heartbeat = (const heartbeat_t *)packet->data;
+        
+        // A new boot ID means the peripheral restarted: its keys are up and
+        // its sequence count started over, so the window has to start over too
+        if (peripheral->boot_known && heartbeat->boot_id != peripheral->boot_id) {
+            release_peripheral_keys(peripheral);
+            printf("%s restarted - cleared keys\n", peripheral->config->name);
+        }
+        peripheral->boot_id = heartbeat->boot_id;
+        peripheral->boot_known = true;
+        
+        peripheral->last_seen = timer_read();
+        peripheral->connected = true;
+    }
+}
+
+// Drain the RX queue, parsing each packet in place in its pbuf
+static void rx_queue_task(void) {
+    while (rx_queue.head != rx_queue.tail) {
+        struct pbuf *p = rx_queue.slots[rx_queue.head & RX_QUEUE_MASK];
+        
+        process_packet((const keyboard_packet_t *)p->payload);
         pbuf_free(p);
+        
+        rx_queue.head++;
+        rx_stats.processed++;
     }
 }
 
@@ -164,52 +179,42 @@ static void udp_recv_callback(void *arg, struct udp_pcb *pcb, struct pbuf *p,
                              const ip_addr_t *addr, u16_t port) {
     (void)arg; (void)pcb; (void)addr; (void)port;
     
-    if (p != NULL) {
-        if (p->tot_len >= sizeof(keyboard_packet_t)) {
-            pbuf_copy_partial(p, &rx_packet, sizeof(keyboard_packet_t), 0);
-            
-            if (validate_packet_checksum(&rx_packet)) {
-                if (rx_packet.type == PACKET_MATRIX_UPDATE) {
-                    // Check sequence number to avoid processing duplicates
-                    uint16_t *last_seq = (rx_packet.device_id == DEVICE_LEFT) ? 
-                                        &state.left_last_sequence : 
-                                        &state.right_last_sequence;
-                    
-                    // Allow for some out-of-order packets (sequence within 10 of last)
-                    int16_t seq_diff = (int16_t)(rx_packet.sequence - *last_seq);
-                    
-                    if (seq_diff > 0 || seq_diff < -100) {
-                        // New packet or very old packet (likely wrapped around)
-                        process_matrix_update(rx_packet.device_id, 
-                                            (matrix_state_t *)rx_packet.data);
-                        *last_seq = rx_packet.sequence;
-                        
-                        // Send ACK back
-                        send_ack_packet(rx_packet.device_id, rx_packet.sequence);
-                        
-                        // Very brief LED flash for feedback
-                        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-                        sleep_us(100);
-                        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-                    }
-                    // else: duplicate or slightly out-of-order, still send ACK
-                    else {
-                        send_ack_packet(rx_packet.device_id, rx_packet.sequence);
-                    }
-                    
-                } else if (rx_packet.type == PACKET_HEARTBEAT) {
-                    uint32_t now = timer_read();
-                    if (rx_packet.device_id == DEVICE_LEFT) {
-                        state.left_last_seen = now;
-                        state.left_connected = true;
-                    } else if (rx_packet.device_id == DEVICE_RIGHT) {
-                        state.right_last_seen = now;
-                        state.right_connected = true;
-                    }
-                }
-            }
-        }
+    if (p == NULL) return;
+    
+    uint32_t entry_us = timer_read_us();
+    
+    // Only accept packets that sit contiguously in the first pbuf so they can
+    // be parsed in place without copying
+    const keyboard_packet_t *packet = (const keyboard_packet_t *)p->payload;
+    bool valid = p->len >= sizeof(keyboard_packet_t) &&
+                 validate_packet_checksum(packet) &&
+                 (packet->type == PACKET_MATRIX_UPDATE ||
+                  packet->type == PACKET_HEARTBEAT);
+    
+    uint8_t depth = rx_queue.tail - rx_queue.head;
+    
+    if (!valid) {
+        rx_stats.dropped_invalid++;
         pbuf_free(p);
+    } else if (depth >= RX_QUEUE_SIZE) {
+        rx_stats.dropped_full++;
+        pbuf_free(p);
+    } else {
+        // Queue takes ownership of the pbuf, freed once processed
+        rx_queue.slots[rx_queue.tail & RX_QUEUE_MASK] = p;
+        rx_queue.tail++;
+        rx_stats.enqueued++;
+        
+        if (depth + 1 > rx_stats.depth_max) {
+            rx_stats.depth_max = depth + 1;
+        }
+    }
+    
+    uint32_t duration_us = timer_elapsed_us(entry_us);
+    rx_stats.callback_us_total += duration_us;
+    rx_stats.callback_count++;
+    if (duration_us > rx_stats.callback_us_max) {
+        rx_stats.callback_us_max = duration_us;
     }
 }
 
@@ -223,6 +228,7 @@ int main() {
     printf("1. USB init...\n");
     board_init();
     tusb_init();
+    usb_hid_init();
     
     // Wait for USB enumeration with continuous task polling
     printf("2. Waiting for USB enumeration...\n");
@@ -250,10 +256,15 @@ int main() {
     // Features (before WiFi)
     printf("4. Features init...\n");
     init_features();
-    init_combos();
     mouse_init();
     autoclicker_init();
-    printf("   OK\n");
+    printf("   OK - feature flags 0x%02lx, %u stages\n",
+           get_feature_flags(), pipeline_stage_count());
+    printf("   SRAM: data %u bytes%s, bss %u bytes, %u bytes left for heap\n",
+           (unsigned)(__data_end__ - __data_start__),
+           RAM_HOT_PATH ? " (with hot path)" : "",
+           (unsigned)(__bss_end__ - __bss_start__),
+           (unsigned)(__StackLimit - __bss_end__));
     
     // NOW start WiFi - but keep tud_task() running
     printf("\n=== Starting WiFi (USB task will keep running) ===\n");
@@ -341,14 +352,14 @@ int main() {
         }
     }
     
-    printf("\n=== Dongle ready! Waiting for keyboard halves... ===\n");
+    printf("\n=== Dongle ready! Waiting for peripherals... ===\n");
     
-    // Initialize state
-    memset(&state, 0, sizeof(state));
+    // Initialize peripheral table
+    peripherals_init();
     
     uint32_t last_status_check = 0;
     uint32_t last_usb_check = 0;
-    uint32_t last_feature_task = 0;
+    uint32_t last_stats_print = 0;
     
     // Main loop - USB TASK MUST BE FIRST
     while (1) {
@@ -357,71 +368,150 @@ int main() {
         // USB task is highest priority - run frequently
         tud_task();
         
-        // WiFi polling for AP mode
+        // WiFi polling for AP mode - only enqueues received packets
         cyw43_arch_poll();
         
-        // Send HID reports if needed
-        send_hid_report();
+        // Process queued packets outside of the lwIP callback
+        rx_queue_task();
         
-        // Run feature tasks periodically (every 5ms)
-        if (now - last_feature_task > 5) {
-            mouse_task();
-            autoclicker_task();
-            modtap_task();
-            tap_dance_task();
-            oneshot_task();
-            last_feature_task = now;
+        // End the per-packet LED flash
+        if (led_flash_active && timer_elapsed_us(led_flash_start) >= 1000) {
+            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+            led_flash_active = false;
         }
         
-        // Check for disconnected halves (timeout after 2 seconds)
-        if (state.left_connected && (now - state.left_last_seen > 2000)) {
-            state.left_connected = false;
-            // Clear any stuck keys from left half
-            for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-                for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-                    if (state.left_matrix.rows[row] & (1 << col)) {
-                        uint8_t layer = get_highest_layer();
-                        uint16_t keycode = get_keycode_at(layer, row, col);
-                        unregister_key(keycode);
-                    }
-                }
-                state.left_matrix.rows[row] = 0;
+        // Send HID reports if needed - keyboard and mouse have separate
+        // endpoints and are scheduled independently
+        send_hid_report();
+        mouse_task();
+        
+        // Run feature timeouts that have come due
+        deadline_task();
+        
+        // Check for disconnected peripherals (timeout after 2 seconds)
+        for (uint8_t i = 0; i < peripheral_count(); i++) {
+            peripheral_t *peripheral = peripheral_at(i);
+            if (peripheral == NULL || !peripheral->connected) continue;
+            
+            if (now - peripheral->last_seen > 2000) {
+                // Clear any stuck keys from this peripheral
+                release_peripheral_keys(peripheral);
+                printf("%s disconnected - cleared keys\n", peripheral->config->name);
             }
-            send_hid_report();
-            printf("Left half disconnected - cleared keys\n");
         }
         
-        if (state.right_connected && (now - state.right_last_seen > 2000)) {
-            state.right_connected = false;
-            // Clear any stuck keys from right half
+        // RX and HID queue statistics every 10 seconds (for debugging)
+        if (now - last_stats_print > 10000) {
+            last_stats_print = now;
+            printf("RX: queued %lu, processed %lu, dropped full %lu, invalid %lu, stale %lu, "
+                   "max depth %u, callback avg %luus max %luus\n",
+                   rx_stats.enqueued,
+                   rx_stats.processed,
+                   rx_stats.dropped_full,
+                   rx_stats.dropped_invalid,
+                   rx_stats.stale,
+                   rx_stats.depth_max,
+                   rx_stats.callback_count ? rx_stats.callback_us_total / rx_stats.callback_count : 0,
+                   rx_stats.callback_us_max);
+            
+            const hid_report_stats_t *hid_stats = get_hid_report_stats();
+            printf("HID: queued %lu, sent %lu, overflows %lu, max depth %u\n",
+                   hid_stats->queued,
+                   hid_stats->sent,
+                   hid_stats->overflows,
+                   hid_stats->depth_max);
+            
+            const hid_latency_stats_t *latency_stats = get_hid_latency_stats();
+            if (latency_stats->completions > 0) {
+                printf("USB: latency avg %luus, jitter %luus\n",
+                       latency_stats->latency_us_total / latency_stats->completions,
+                       latency_stats->latency_us_max - latency_stats->latency_us_min);
+            }
+            
+            const deadline_stats_t *dl_stats = get_deadline_stats();
+            if (dl_stats->fired > 0) {
+                printf("Deadlines: fired %lu, late avg %luus, max %luus, max depth %u\n",
+                       dl_stats->fired,
+                       dl_stats->late_us_total / dl_stats->fired,
+                       dl_stats->late_us_max,
+                       dl_stats->depth_max);
+            }
+            
+            const macro_stats_t *macro_stats = get_macro_stats();
+            if (macro_stats->played > 0) {
+                printf("Macros: played %lu, steps %lu, waits %lu, dropped %lu\n",
+                       macro_stats->played,
+                       macro_stats->steps,
+                       macro_stats->waits,
+                       macro_stats->dropped);
+            }
+            
+#if DYNAMIC_MACRO_ENABLE
+            for (uint8_t i = 0; i < DYNAMIC_MACRO_SLOTS; i++) {
+                const dynamic_macro_info_t *dm_info = get_dynamic_macro_info(i);
+                if (dm_info->used == 0 && !dm_info->truncated) continue;
+                printf("Dynamic macro %u: %u/%u bytes%s\n",
+                       i + 1,
+                       dm_info->used,
+                       dm_info->size,
+                       dm_info->truncated ? ", truncated" : "");
+            }
+#endif
+            
+#if ADAPTIVE_TERM_ENABLE
             for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-                for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-                    if (state.right_matrix.rows[row] & (1 << col)) {
-                        uint8_t layer = get_highest_layer();
-                        uint16_t keycode = get_keycode_at(layer, row, col + MATRIX_COLS);
-                        unregister_key(keycode);
-                    }
+                for (uint8_t col = 0; col < KEYMAP_COLS; col++) {
+                    adaptive_term_info_t term_info;
+                    get_adaptive_term_info(row, col, &term_info);
+                    if (term_info.taps == 0 && term_info.holds == 0) continue;
+                    printf("Term %u,%u: %ums, taps %u, holds %u\n",
+                           row, col,
+                           term_info.term_ms,
+                           term_info.taps,
+                           term_info.holds);
                 }
-                state.right_matrix.rows[row] = 0;
             }
-            send_hid_report();
-            printf("Right half disconnected - cleared keys\n");
+#endif
+            
+            const pipeline_event_stats_t *event_stats = get_pipeline_event_stats();
+            if (event_stats->events > 0) {
+                printf("Pipeline: events %lu, avg %lu cycles, max %lu cycles\n",
+                       event_stats->events,
+                       (uint32_t)(event_stats->cycles_total / event_stats->events),
+                       event_stats->cycles_max);
+                printf("XIP per event: accesses avg %lu, misses avg %lu, max %lu\n",
+                       (uint32_t)(event_stats->xip_accesses / event_stats->events),
+                       (uint32_t)(event_stats->xip_misses / event_stats->events),
+                       event_stats->xip_misses_max);
+            }
+            
+            for (uint8_t i = 0; i < pipeline_stage_count(); i++) {
+                const pipeline_stage_t *stage = pipeline_stage_at(i);
+                if (stage->calls == 0) continue;
+                printf("Stage %s: calls %lu, avg %luus, max %luus\n",
+                       stage->name,
+                       stage->calls,
+                       stage->total_us / stage->calls,
+                       stage->max_us);
+            }
         }
         
         // LED status indicator every 2 seconds
         if (now - last_status_check > 2000) {
             last_status_check = now;
             
-            if (state.left_connected && state.right_connected) {
-                // Both connected - 2 quick blinks
+            uint8_t connected = peripheral_connected_count();
+            
+            if (connected > 0 && connected == peripheral_count()) {
+                // All connected - 2 quick blinks
                 for (int i = 0; i < 2; i++) {
                     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
                     sleep_ms(100);
                     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
                     sleep_ms(100);
                 }
-            } else if (state.left_connected || state.right_connected) {
-                // One connected - 1 blink
+            } else if (connected > 0) {
+                // Some connected - 1 blink
                 cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
                 sleep_ms(200);
                 cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
@@ -433,8 +523,9 @@ int main() {
             }
         }
         
-        // Small consistent delay
-        sleep_us(1000);  // 1ms = 1000 Hz loop rate
+        // Sleep until WiFi work, a USB interrupt or the next feature
+        // deadline, at most 1ms
+        cyw43_arch_wait_for_work_until(deadline_wake_time(1000));
     }
     
     return 0;
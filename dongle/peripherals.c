@@ -0,0 +1,123 @@
+#include <string.h>
+#include "peripherals.h"
+#include "pipeline.h"
+#include "timer.h"
+#include "hot_path.h"
+
+// Peripheral table - add an entry per device paired with this dongle.
+// Each device's columns are placed at col_offset in the keymap. A device
+// whose columns fall past KEYMAP_COLS is skipped, so adding one means
+// widening the keymap first. A build can supply its own table through
+// PERIPHERAL_TABLE_FILE.
+#ifdef PERIPHERAL_TABLE_FILE
+#include PERIPHERAL_TABLE_FILE
+#else
+static const peripheral_config_t peripheral_configs[] = {
+    { DEVICE_LEFT,  "Left half",  LEFT_IP,  MATRIX_ROWS, MATRIX_COLS, 0 },
+    { DEVICE_RIGHT, "Right half", RIGHT_IP, MATRIX_ROWS, MATRIX_COLS, MATRIX_COLS },
+};
+#endif
+
+#define PERIPHERAL_COUNT (sizeof(peripheral_configs) / sizeof(peripheral_configs[0]))
+
+static peripheral_t peripherals[PERIPHERAL_COUNT];
+
+// Direct device ID -> peripheral index, so per-packet lookup does not
+// depend on the number of configured devices
+static peripheral_t *device_lookup[MAX_PERIPHERALS + 1];
+
+void peripherals_init(void) {
+    memset(peripherals, 0, sizeof(peripherals));
+    memset(device_lookup, 0, sizeof(device_lookup));
+    
+    for (uint8_t i = 0; i < PERIPHERAL_COUNT; i++) {
+        const peripheral_config_t *config = &peripheral_configs[i];
+        
+        if (config->device_id == DEVICE_DONGLE || config->device_id > MAX_PERIPHERALS) continue;
+        if (config->rows > MATRIX_ROWS || config->cols > PERIPHERAL_MAX_COLS) continue;
+        if (config->col_offset + config->cols > KEYMAP_COLS) continue;  // Outside the keymap
+        
+        peripherals[i].config = config;
+        ipaddr_aton(config->ip, &peripherals[i].addr);
+        replay_window_init(&peripherals[i].window);
+        device_lookup[config->device_id] = &peripherals[i];
+    }
+}
+
+peripheral_t *peripheral_get(uint8_t device_id) {
+    if (device_id > MAX_PERIPHERALS) return NULL;
+    return device_lookup[device_id];
+}
+
+uint8_t peripheral_count(void) {
+    return PERIPHERAL_COUNT;
+}
+
+peripheral_t *peripheral_at(uint8_t index) {
+    if (index >= PERIPHERAL_COUNT || peripherals[index].config == NULL) return NULL;
+    return &peripherals[index];
+}
+
+uint8_t peripheral_connected_count(void) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < PERIPHERAL_COUNT; i++) {
+        if (peripherals[i].connected) count++;
+    }
+    return count;
+}
+
+void peripheral_reset(peripheral_t *peripheral) {
+    peripheral->connected = false;
+    memset(&peripheral->matrix, 0, sizeof(peripheral->matrix));
+    
+    // Key stamps stay: the first packet after the restart lands past them
+    replay_window_restart(&peripheral->window);
+}
+
+void HOT_PATH(peripheral_apply_matrix)(peripheral_t *peripheral, const matrix_state_t *matrix,
+                                       uint16_t sequence, bool late) {
+    const peripheral_config_t *config = peripheral->config;
+    matrix_state_t *target = &peripheral->matrix;
+    uint8_t col_mask = (uint8_t)((1u << config->cols) - 1);
+    uint32_t position = replay_window_position(&peripheral->window, sequence);
+    
+    // Process only the CHANGES, not the entire matrix
+    for (uint8_t row = 0; row < config->rows; row++) {
+        uint8_t old_row = target->rows[row];
+        uint8_t new_row = matrix->rows[row] & col_mask;
+        
+        // The newest packet is authoritative for the whole row, a late one
+        // only for the keys it says it changed
+        uint8_t marked = matrix->changed_mask[row] & col_mask;
+        uint8_t changed = late ? marked : (marked | (old_row ^ new_row));
+        
+        if (changed == 0) continue; // No changes in this row
+        
+        uint8_t applied = 0;
+        for (uint8_t col = 0; col < config->cols; col++) {
+            if (!(changed & (1 << col))) continue; // This key didn't change
+            
+            // Skip keys already updated by a newer packet
+            if ((int32_t)(position - peripheral->key_position[row][col]) < 0) continue;
+            peripheral->key_position[row][col] = position;
+            applied |= (1 << col);
+            
+            bool is_pressed = (new_row & (1 << col)) != 0;
+            bool was_pressed = (old_row & (1 << col)) != 0;
+            uint8_t keymap_col = col + config->col_offset;
+            
+            // Marked as changed but already in this state: the opposite
+            // edge was in a packet that has not arrived, so replay it
+            // first rather than lose a quick tap
+            if (is_pressed == was_pressed) {
+                pipeline_process_key(row, keymap_col, !is_pressed, config->device_id);
+            }
+            pipeline_process_key(row, keymap_col, is_pressed, config->device_id);
+        }
+        
+        target->rows[row] = (old_row & ~applied) | (new_row & applied);
+    }
+    
+    peripheral->last_seen = timer_read();
+    peripheral->connected = true;
+}
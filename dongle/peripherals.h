@@ -0,0 +1,55 @@
+#ifndef PERIPHERALS_H
+#define PERIPHERALS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+#include "config.h"
+#include "protocol.h"
+#include "replay_window.h"
+
+// Widest matrix a peripheral can report (one bit per column in matrix_state_t)
+#define PERIPHERAL_MAX_COLS 8
+
+// Static description of a peripheral paired with the dongle
+typedef struct {
+    uint8_t device_id;
+    const char *name;
+    const char *ip;
+    uint8_t rows;        // Matrix geometry reported by the device
+    uint8_t cols;
+    uint8_t col_offset;  // Keymap column of the device's first column
+} peripheral_config_t;
+
+// Runtime state for one peripheral
+typedef struct {
+    const peripheral_config_t *config;
+    ip_addr_t addr;
+    matrix_state_t matrix;
+    replay_window_t window;
+    uint32_t key_position[MATRIX_ROWS][PERIPHERAL_MAX_COLS];  // Replay position of each key's last update
+    uint32_t last_seen;
+    uint32_t boot_id;  // From the last heartbeat, valid once boot_known
+    bool boot_known;
+    bool connected;
+} peripheral_t;
+
+void peripherals_init(void);
+
+// O(1) lookup by device ID, NULL if the ID is not configured
+peripheral_t *peripheral_get(uint8_t device_id);
+
+// Iteration over configured peripherals
+uint8_t peripheral_count(void);
+peripheral_t *peripheral_at(uint8_t index);
+uint8_t peripheral_connected_count(void);
+
+// Reset connection tracking after a timeout
+void peripheral_reset(peripheral_t *peripheral);
+
+// Feed a matrix update the replay window accepted at `sequence` through
+// the pipeline. Keys a newer packet already updated are left alone.
+void peripheral_apply_matrix(peripheral_t *peripheral, const matrix_state_t *matrix,
+                             uint16_t sequence, bool late);
+
+#endif // PERIPHERALS_H
@@ -33,14 +33,14 @@ extern "C" {
 #endif
 
 //------------- CLASS -------------//
-#define CFG_TUD_HID               1
+#define CFG_TUD_HID               2  // Keyboard and mouse interfaces
 #define CFG_TUD_CDC               1  // Enable CDC for USB serial
 #define CFG_TUD_MSC               0
 #define CFG_TUD_MIDI              0
 #define CFG_TUD_VENDOR            0
 
-// HID buffer size
-#define CFG_TUD_HID_EP_BUFSIZE    16
+// HID buffer size (report ID + modifiers + NKRO bitmap)
+#define CFG_TUD_HID_EP_BUFSIZE    32
 
 // CDC buffer sizes
 #define CFG_TUD_CDC_RX_BUFSIZE    256
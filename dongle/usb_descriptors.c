@@ -1,6 +1,7 @@
 #include <string.h>
 #include "tusb.h"
 #include "pico/unique_id.h"
+#include "usb_hid.h"
 
 #define _PID_MAP(itf, n)  ( (CFG_TUD_##itf) << (n) )
 #define USB_PID           (0x4000 | _PID_MAP(CDC, 0) | _PID_MAP(MSC, 1) | _PID_MAP(HID, 2) | \
@@ -39,29 +40,50 @@ uint8_t const * tud_descriptor_device_cb(void)
 // HID Report Descriptors
 //--------------------------------------------------------------------+
 
-// Keyboard Report Descriptor
+// NKRO Keyboard Report Descriptor - modifier byte followed by one bit per
+// key usage, so any number of keys can be reported at once
+#define TUD_HID_REPORT_DESC_NKRO(...) \
+    HID_USAGE_PAGE ( HID_USAGE_PAGE_DESKTOP                  )         ,\
+    HID_USAGE      ( HID_USAGE_DESKTOP_KEYBOARD              )         ,\
+    HID_COLLECTION ( HID_COLLECTION_APPLICATION              )         ,\
+        /* Report ID if any */\
+        __VA_ARGS__ \
+        /* 8 bits Modifier Keys (Shift, Control, Alt) */ \
+        HID_USAGE_PAGE ( HID_USAGE_PAGE_KEYBOARD             )         ,\
+        HID_USAGE_MIN  ( 224                                 )         ,\
+        HID_USAGE_MAX  ( 231                                 )         ,\
+        HID_LOGICAL_MIN( 0                                   )         ,\
+        HID_LOGICAL_MAX( 1                                   )         ,\
+        HID_REPORT_COUNT( 8                                  )         ,\
+        HID_REPORT_SIZE( 1                                   )         ,\
+        HID_INPUT      ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )      ,\
+        /* Key bitmap, one bit per usage */ \
+        HID_USAGE_PAGE ( HID_USAGE_PAGE_KEYBOARD             )         ,\
+        HID_USAGE_MIN  ( 0                                   )         ,\
+        HID_USAGE_MAX  ( NKRO_REPORT_KEYS - 1                )         ,\
+        HID_LOGICAL_MIN( 0                                   )         ,\
+        HID_LOGICAL_MAX( 1                                   )         ,\
+        HID_REPORT_COUNT( NKRO_REPORT_KEYS                   )         ,\
+        HID_REPORT_SIZE( 1                                   )         ,\
+        HID_INPUT      ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )      ,\
+    HID_COLLECTION_END \
+
+// Keyboard Report Descriptor - 6KRO report plus the NKRO bitmap report
 uint8_t const desc_hid_keyboard_report[] =
 {
-    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(1))
+    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD)),
+    TUD_HID_REPORT_DESC_NKRO(HID_REPORT_ID(REPORT_ID_NKRO))
 };
 
 // Mouse Report Descriptor with extended buttons
 uint8_t const desc_hid_mouse_report[] =
 {
-    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(2))
-};
-
-// Combined report descriptor
-uint8_t const desc_hid_report[] =
-{
-    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(1)),
-    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(2))
+    TUD_HID_REPORT_DESC_MOUSE()
 };
 
 uint8_t const * tud_hid_descriptor_report_cb(uint8_t instance)
 {
-    (void) instance;
-    return desc_hid_report;
+    return (instance == HID_ITF_MOUSE) ? desc_hid_mouse_report : desc_hid_keyboard_report;
 }
 
 //--------------------------------------------------------------------+
@@ -70,18 +92,25 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t instance)
 
 enum
 {
-    ITF_NUM_HID,
+    ITF_NUM_KEYBOARD,
+    ITF_NUM_MOUSE,
     ITF_NUM_TOTAL
 };
 
-#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
+#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + 2 * TUD_HID_DESC_LEN)
+
+#define EPNUM_KEYBOARD   0x81
+#define EPNUM_MOUSE      0x82
 
-#define EPNUM_HID   0x81
+// Poll both interfaces every frame (1 ms)
+#define HID_POLL_INTERVAL_MS 1
 
 uint8_t const desc_configuration[] =
 {
     TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
-    TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report), EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, 5)
+    // Keyboard interface supports the boot protocol
+    TUD_HID_DESCRIPTOR(ITF_NUM_KEYBOARD, 0, HID_ITF_PROTOCOL_KEYBOARD, sizeof(desc_hid_keyboard_report), EPNUM_KEYBOARD, CFG_TUD_HID_EP_BUFSIZE, HID_POLL_INTERVAL_MS),
+    TUD_HID_DESCRIPTOR(ITF_NUM_MOUSE, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_mouse_report), EPNUM_MOUSE, CFG_TUD_HID_EP_BUFSIZE, HID_POLL_INTERVAL_MS)
 };
 
 uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
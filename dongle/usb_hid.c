@@ -1,106 +1,181 @@
 #include "usb_hid.h"
+#include "timer.h"
 #include "tusb.h"
+#include "pico/stdlib.h"
 #include "keycodes.h"
+#include "config.h"
+#include "mouse.h"
+#include "hot_path.h"
 #include <string.h>
 
-// HID Report structure
+// HID Report structure (6KRO, boot compatible)
 static struct {
     uint8_t modifiers;
     uint8_t reserved;
     uint8_t keycodes[6];
 } hid_report = {0};
 
-static bool report_dirty = false;
+// NKRO Report structure (matches TUD_HID_REPORT_DESC_NKRO)
+typedef struct {
+    uint8_t modifiers;
+    uint8_t bits[NKRO_REPORT_BYTES];
+} nkro_report_t;
 
-// Convert QMK keycode to HID keycode
-uint8_t qmk_to_hid(uint16_t keycode) {
-    if (keycode >= KC_A && keycode <= KC_0) {
-        return (uint8_t)keycode;
-    }
-    
-    switch (keycode) {
-        case KC_ENT:  return 0x28;
-        case KC_ESC:  return 0x29;
-        case KC_BSPC: return 0x2A;
-        case KC_TAB:  return 0x2B;
-        case KC_SPC:  return 0x2C;
-        case KC_MINS: return 0x2D;
-        case KC_EQL:  return 0x2E;
-        case KC_LBRC: return 0x2F;
-        case KC_RBRC: return 0x30;
-        case KC_BSLS: return 0x31;
-        case KC_SCLN: return 0x33;
-        case KC_QUOT: return 0x34;
-        case KC_GRV:  return 0x35;
-        case KC_COMM: return 0x36;
-        case KC_DOT:  return 0x37;
-        case KC_SLSH: return 0x38;
-        case KC_CAPS: return 0x39;
-        
-        case KC_F1:   return 0x3A;
-        case KC_F2:   return 0x3B;
-        case KC_F3:   return 0x3C;
-        case KC_F4:   return 0x3D;
-        case KC_F5:   return 0x3E;
-        case KC_F6:   return 0x3F;
-        case KC_F7:   return 0x40;
-        case KC_F8:   return 0x41;
-        case KC_F9:   return 0x42;
-        case KC_F10:  return 0x43;
-        case KC_F11:  return 0x44;
-        case KC_F12:  return 0x45;
-        
-        case KC_INS:  return 0x49;
-        case KC_HOME: return 0x4A;
-        case KC_PGUP: return 0x4B;
-        case KC_DEL:  return 0x4C;
-        case KC_END:  return 0x4D;
-        case KC_PGDN: return 0x4E;
-        case KC_RIGHT:return 0x4F;
-        case KC_LEFT: return 0x50;
-        case KC_DOWN: return 0x51;
-        case KC_UP:   return 0x52;
+static nkro_report_t nkro_report = {0};
+
+static uint8_t key_count = 0;  // Keys set in the NKRO bitmap
+static bool nkro_enabled = NKRO_ENABLE;
+static uint8_t keyboard_protocol = HID_PROTOCOL_REPORT;
+
+// Report FIFO - every distinct keyboard state is queued and sent in order,
+// one report per USB interval, so fast press/release pairs reach the host
+#define HID_REPORT_QUEUE_SIZE 32  // Must be a power of two
+#define HID_REPORT_QUEUE_MASK (HID_REPORT_QUEUE_SIZE - 1)
+
+typedef struct {
+    bool nkro;  // Report format chosen when the state was queued
+    uint8_t modifiers;
+    uint8_t keycodes[6];
+    uint8_t bits[NKRO_REPORT_BYTES];
+} queued_report_t;
+
+static struct {
+    queued_report_t entries[HID_REPORT_QUEUE_SIZE];
+    uint8_t head;  // Next report to send
+    uint8_t tail;  // Next free entry
+    queued_report_t last;  // Most recently queued state
+} report_queue = {0};
+
+static hid_report_stats_t report_stats = {0};
+
+// Submission to completion timing of the report in flight
+static struct {
+    uint32_t submit_us;
+    bool in_flight;
+} latency_state = {0};
+
+static hid_latency_stats_t latency_stats = {0};
+
+static inline bool HOT_PATH(nkro_test)(uint8_t hid_keycode) {
+    return (nkro_report.bits[hid_keycode >> 3] & (1 << (hid_keycode & 7))) != 0;
+}
+
+// Refill a freed 6KRO slot from keys that only fit in the NKRO bitmap
+static void HOT_PATH(boot_report_backfill)(void) {
+    for (uint16_t code = 1; code < NKRO_REPORT_KEYS; code++) {
+        if (!nkro_test(code)) continue;
         
-        default:
-            if (keycode < 0xFF) {
-                return (uint8_t)keycode;
+        bool present = false;
+        for (int i = 0; i < 5; i++) {
+            if (hid_report.keycodes[i] == code) {
+                present = true;
+                break;
             }
-            return 0;
+        }
+        if (!present) {
+            hid_report.keycodes[5] = code;
+            return;
+        }
     }
 }
 
-void register_key(uint16_t keycode) {
+static void HOT_PATH(snapshot_report)(queued_report_t *entry) {
+    entry->nkro = is_nkro_active();
+    entry->modifiers = hid_report.modifiers;
+    memcpy(entry->keycodes, hid_report.keycodes, sizeof(entry->keycodes));
+    memcpy(entry->bits, nkro_report.bits, sizeof(entry->bits));
+}
+
+// Queue the current keyboard state if it differs from the last queued one
+static void HOT_PATH(queue_report)(void) {
+    queued_report_t current;
+    snapshot_report(&current);
+    
+    if (memcmp(&current, &report_queue.last, sizeof(current)) == 0) return;
+    report_queue.last = current;
+    
+    uint8_t depth = report_queue.tail - report_queue.head;
+    if (depth >= HID_REPORT_QUEUE_SIZE) {
+        // Queue full - fold this state into the newest entry
+        report_queue.entries[(report_queue.tail - 1) & HID_REPORT_QUEUE_MASK] = current;
+        report_stats.overflows++;
+        return;
+    }
+    
+    report_queue.entries[report_queue.tail & HID_REPORT_QUEUE_MASK] = current;
+    report_queue.tail++;
+    report_stats.queued++;
+    
+    if (depth + 1 > report_stats.depth_max) {
+        report_stats.depth_max = depth + 1;
+    }
+}
+
+// QMK basic keycodes are HID usages - flat translation table, 0 marks
+// codes without a usage (KC_NO, KC_TRNS, reserved ranges)
+static const uint8_t hid_usage_table[256] HOT_DATA(hid_usage_table) = {
+    /* 0x00 */ 0x00, 0x00, 0x00, 0x00, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    /* 0x10 */ 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    /* 0x20 */ 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    /* 0x30 */ 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    /* 0x40 */ 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    /* 0x50 */ 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F,
+    /* 0x60 */ 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+    /* 0x70 */ 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F,
+    /* 0x80 */ 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F,
+    /* 0x90 */ 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F,
+    /* 0xA0 */ 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* 0xB0 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* 0xC0 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* 0xD0 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* 0xE0 */ 0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* 0xF0 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+// Convert QMK keycode to HID keycode
+uint8_t HOT_PATH(qmk_to_hid)(uint16_t keycode) {
+    if (keycode > 0xFF) return 0;
+    return hid_usage_table[keycode];
+}
+
+void HOT_PATH(register_key)(uint16_t keycode) {
     if (keycode >= KC_LCTL && keycode <= KC_RGUI) {
         register_modifier(keycode);
         return;
     }
     
     uint8_t hid_keycode = qmk_to_hid(keycode);
-    if (hid_keycode == 0) return;
+    if (hid_keycode == 0 || hid_keycode >= NKRO_REPORT_KEYS) return;
     
-    for (int i = 0; i < 6; i++) {
-        if (hid_report.keycodes[i] == hid_keycode) {
-            return;
-        }
-    }
+    // O(1) set in the NKRO bitmap
+    uint8_t bit = 1 << (hid_keycode & 7);
+    uint8_t *byte = &nkro_report.bits[hid_keycode >> 3];
+    if (*byte & bit) return;
+    *byte |= bit;
     
-    for (int i = 0; i < 6; i++) {
-        if (hid_report.keycodes[i] == 0) {
-            hid_report.keycodes[i] = hid_keycode;
-            report_dirty = true;
-            break;
-        }
+    // Mirror into the 6KRO report while there is room
+    if (key_count < 6) {
+        hid_report.keycodes[key_count] = hid_keycode;
     }
+    key_count++;
+    queue_report();
 }
 
-void unregister_key(uint16_t keycode) {
+void HOT_PATH(unregister_key)(uint16_t keycode) {
     if (keycode >= KC_LCTL && keycode <= KC_RGUI) {
         unregister_modifier(keycode);
         return;
     }
     
     uint8_t hid_keycode = qmk_to_hid(keycode);
-    if (hid_keycode == 0) return;
+    if (hid_keycode == 0 || hid_keycode >= NKRO_REPORT_KEYS) return;
+    
+    // O(1) clear in the NKRO bitmap
+    uint8_t bit = 1 << (hid_keycode & 7);
+    uint8_t *byte = &nkro_report.bits[hid_keycode >> 3];
+    if (!(*byte & bit)) return;
+    *byte &= ~bit;
+    key_count--;
     
     for (int i = 0; i < 6; i++) {
         if (hid_report.keycodes[i] == hid_keycode) {
@@ -108,63 +183,91 @@ void unregister_key(uint16_t keycode) {
                 hid_report.keycodes[j] = hid_report.keycodes[j + 1];
             }
             hid_report.keycodes[5] = 0;
-            report_dirty = true;
+            
+            // More than 6 keys held - promote one into the boot report
+            if (key_count >= 6) {
+                boot_report_backfill();
+            }
             break;
         }
     }
+    queue_report();
 }
 
-void register_modifier(uint8_t mod) {
-    uint8_t mod_bit = 0;
+void HOT_PATH(register_modifier)(uint8_t mod) {
+    if (mod < KC_LCTL || mod > KC_RGUI) return;
     
-    switch (mod) {
-        case KC_LCTL: mod_bit = 0x01; break;
-        case KC_LSFT: mod_bit = 0x02; break;
-        case KC_LALT: mod_bit = 0x04; break;
-        case KC_LGUI: mod_bit = 0x08; break;
-        case KC_RCTL: mod_bit = 0x10; break;
-        case KC_RSFT: mod_bit = 0x20; break;
-        case KC_RALT: mod_bit = 0x40; break;
-        case KC_RGUI: mod_bit = 0x80; break;
-        default: return;
-    }
+    // Modifier keycodes KC_LCTL..KC_RGUI map to report bits 0..7
+    uint8_t mod_bit = 1 << (mod - KC_LCTL);
     
     hid_report.modifiers |= mod_bit;
-    report_dirty = true;
-}
-
-void unregister_modifier(uint8_t mod) {
-    uint8_t mod_bit = 0;
-    
-    switch (mod) {
-        case KC_LCTL: mod_bit = 0x01; break;
-        case KC_LSFT: mod_bit = 0x02; break;
-        case KC_LALT: mod_bit = 0x04; break;
-        case KC_LGUI: mod_bit = 0x08; break;
-        case KC_RCTL: mod_bit = 0x10; break;
-        case KC_RSFT: mod_bit = 0x20; break;
-        case KC_RALT: mod_bit = 0x40; break;
-        case KC_RGUI: mod_bit = 0x80; break;
-        default: return;
-    }
+    queue_report();
+}
+
+void HOT_PATH(unregister_modifier)(uint8_t mod) {
+    if (mod < KC_LCTL || mod > KC_RGUI) return;
+    
+    // Modifier keycodes KC_LCTL..KC_RGUI map to report bits 0..7
+    uint8_t mod_bit = 1 << (mod - KC_LCTL);
     
     hid_report.modifiers &= ~mod_bit;
-    report_dirty = true;
+    queue_report();
 }
 
-void send_hid_report(void) {
-    if (!report_dirty) return;
-    if (!tud_hid_ready()) return;
+void HOT_PATH(send_hid_report)(void) {
+    if (report_queue.head == report_queue.tail) return;
+    if (!tud_hid_n_ready(HID_ITF_KEYBOARD)) return;
     if (!tud_mounted()) return;
     
-    tud_hid_keyboard_report(1, hid_report.modifiers, hid_report.keycodes);
-    report_dirty = false;
+    const queued_report_t *entry = &report_queue.entries[report_queue.head & HID_REPORT_QUEUE_MASK];
+    
+    bool sent;
+    if (entry->nkro) {
+        nkro_report_t report;
+        report.modifiers = entry->modifiers;
+        memcpy(report.bits, entry->bits, sizeof(report.bits));
+        sent = tud_hid_n_report(HID_ITF_KEYBOARD, REPORT_ID_NKRO, &report, sizeof(report));
+    } else {
+        // Boot protocol reports carry no report ID
+        uint8_t report_id = (keyboard_protocol == HID_PROTOCOL_BOOT) ? 0 : REPORT_ID_KEYBOARD;
+        sent = tud_hid_n_keyboard_report(HID_ITF_KEYBOARD, report_id, entry->modifiers, entry->keycodes);
+    }
+    
+    if (sent) {
+        report_queue.head++;
+        report_stats.sent++;
+        latency_state.submit_us = timer_read_us();
+        latency_state.in_flight = true;
+    }
+}
+
+void usb_hid_init(void) {
+    memset(&latency_state, 0, sizeof(latency_state));
+    memset(&latency_stats, 0, sizeof(latency_stats));
+}
+
+const hid_latency_stats_t *get_hid_latency_stats(void) {
+    return &latency_stats;
 }
 
 void clear_keyboard(void) {
     hid_report.modifiers = 0;
     memset(hid_report.keycodes, 0, 6);
-    report_dirty = true;
+    memset(nkro_report.bits, 0, sizeof(nkro_report.bits));
+    key_count = 0;
+    queue_report();
+}
+
+void set_nkro_enabled(bool enabled) {
+    if (enabled == nkro_enabled) return;
+    
+    // Release everything so no key stays stuck in the report being abandoned
+    clear_keyboard();
+    nkro_enabled = enabled;
+}
+
+bool is_nkro_active(void) {
+    return nkro_enabled && keyboard_protocol == HID_PROTOCOL_REPORT;
 }
 
 uint8_t get_modifier_state(void) {
@@ -173,23 +276,13 @@ uint8_t get_modifier_state(void) {
 
 bool is_key_pressed(uint16_t keycode) {
     uint8_t hid_keycode = qmk_to_hid(keycode);
+    if (hid_keycode == 0 || hid_keycode >= NKRO_REPORT_KEYS) return false;
     
-    for (int i = 0; i < 6; i++) {
-        if (hid_report.keycodes[i] == hid_keycode) {
-            return true;
-        }
-    }
-    return false;
+    return nkro_test(hid_keycode);
 }
 
 uint8_t get_key_count(void) {
-    uint8_t count = 0;
-    for (int i = 0; i < 6; i++) {
-        if (hid_report.keycodes[i] != 0) {
-            count++;
-        }
-    }
-    return count;
+    return key_count;
 }
 
 void add_key_to_report(uint16_t keycode) {
@@ -200,26 +293,73 @@ void remove_key_from_report(uint16_t keycode) {
     unregister_key(keycode);
 }
 
+bool hid_report_queue_empty(void) {
+    return report_queue.head == report_queue.tail;
+}
+
+const hid_report_stats_t *get_hid_report_stats(void) {
+    return &report_stats;
+}
+
 // TinyUSB callbacks
 void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len) {
-    (void) instance;
     (void) report;
     (void) len;
+    
+    if (instance == HID_ITF_KEYBOARD) {
+        if (latency_state.in_flight) {
+            // Submission to IN-token completion, the latency added by polling
+            uint32_t latency_us = timer_read_us() - latency_state.submit_us;
+            if (latency_stats.completions == 0 || latency_us < latency_stats.latency_us_min) {
+                latency_stats.latency_us_min = latency_us;
+            }
+            if (latency_us > latency_stats.latency_us_max) {
+                latency_stats.latency_us_max = latency_us;
+            }
+            latency_stats.latency_us_total += latency_us;
+            latency_stats.completions++;
+            latency_state.in_flight = false;
+        }
+        
+        // Endpoint is free again - send the next queued state straight away
+        send_hid_report();
+    } else if (instance == HID_ITF_MOUSE) {
+        // Endpoint is free again - send any pending movement
+        mouse_task();
+    }
 }
 
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, 
                                 hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen) {
-    (void) instance;
     (void) report_type;
     
-    if (report_id == 1 && reqlen >= sizeof(hid_report)) {
+    if (instance != HID_ITF_KEYBOARD) return 0;
+    
+    if (report_id == REPORT_ID_KEYBOARD && reqlen >= sizeof(hid_report)) {
         memcpy(buffer, &hid_report, sizeof(hid_report));
         return sizeof(hid_report);
     }
     
+    if (report_id == REPORT_ID_NKRO && reqlen >= sizeof(nkro_report)) {
+        nkro_report.modifiers = hid_report.modifiers;
+        memcpy(buffer, &nkro_report, sizeof(nkro_report));
+        return sizeof(nkro_report);
+    }
+    
     return 0;
 }
 
+void tud_hid_set_protocol_cb(uint8_t instance, uint8_t protocol) {
+    if (instance != HID_ITF_KEYBOARD) return;
+    
+    // Host switched between boot and report protocol - drop reports queued
+    // in the old format and resend the full state in the one it now expects
+    keyboard_protocol = protocol;
+    report_queue.head = report_queue.tail;
+    memset(&report_queue.last, 0, sizeof(report_queue.last));
+    queue_report();
+}
+
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, 
                            hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize) {
     (void) instance;
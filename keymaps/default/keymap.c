@@ -6,82 +6,25 @@
 #include "layers.h"
 #include "combos.h"
 #include "tapdance.h"
+#include "tap_hold.h"
+#include "modtap.h"
+#include "deadline.h"
 #include "features.h"
 #include "usb_hid.h"
+#include "mouse.h"
+#include "pipeline.h"
+#include "macro.h"
+#include "dynamic_macro.h"
+#include "adaptive_term.h"
+#include "keymap_layout.h"
+#include "hot_path.h"
 
-// Define layers
-enum layers {
-    _BASE,
-    _QWERT,
-    _LOWER,
-    _RAISE,
-    _ADJUST,
-    _MOUSE
-};
-
-// Define tap dance indices
-enum tap_dances {
-    TD_ESC_CAPS,
-    TD_SPC_ENT,
-    TD_Q_ESC
-};
-
-// Custom keycodes (if needed)
-enum custom_keycodes {
-    CUSTOM_1 = 0x7000,
-    CUSTOM_2,
-    CUSTOM_3
-};
-
-// Keymap - 4 rows x 12 columns (6 per half)
-const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS * 2] = {
-    [_BASE] = {
-        // Left Half                                    // Right Half
-        {KC_A, KC_B, KC_C, KC_D, KC_E, KC_F,       KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC},
-        {KC_G, KC_H, KC_I, KC_J, KC_K, KC_L,              KC_H,    KC_J,    KC_K,    KC_L,    KC_SCLN, KC_QUOT},
-        {KC_M, KC_N, KC_O, KC_P, KC_Q, KC_R,       KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, KC_RSFT},
-        {KC_S, KC_T, KC_U, KC_V, KC_W, KC_X,    KC_ENT, MO(_RAISE), KC_RALT, KC_RGUI, OSL(_ADJUST), TD(TD_ESC_CAPS)}
-    },
-
-    [_QWERT] = {
-        // Left Half                                    // Right Half
-        {KC_TAB,  KC_Q,    KC_W,    KC_E,    KC_R,    KC_T,       KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC},
-        {CTL_T(KC_ESC), KC_A, KC_S, KC_D, KC_F, KC_G,              KC_H,    KC_J,    KC_K,    KC_L,    KC_SCLN, KC_QUOT},
-        {KC_LSFT, KC_Z,    KC_X,    KC_C,    KC_V,    KC_B,       KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, KC_RSFT},
-        {KC_LGUI, KC_LALT, MO(_LOWER), KC_SPC, TD(TD_SPC_ENT), MO(_RAISE),    KC_ENT, MO(_RAISE), KC_RALT, KC_RGUI, OSL(_ADJUST), TD(TD_ESC_CAPS)}
-    },
-    
-    [_LOWER] = {
-        {KC_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,       KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL},
-        {_______, KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,      KC_F6,   KC_MINS, KC_EQL,  KC_LBRC, KC_RBRC, KC_BSLS},
-        {_______, KC_F7,   KC_F8,   KC_F9,   KC_F10,  KC_F11,     KC_F12,  KC_HOME, KC_END,  KC_PGUP, KC_PGDN, _______},
-        {_______, _______, _______, _______, _______, _______,    _______, MO(_ADJUST), _______, _______, _______, _______}
-    },
-    
-    [_RAISE] = {
-        {KC_GRV,  KC_EXLM, KC_AT,   KC_HASH, KC_DLR,  KC_PERC,    KC_CIRC, KC_AMPR, KC_ASTR, KC_LPRN, KC_RPRN, KC_DEL},
-        {_______, _______, _______, _______, _______, _______,    KC_LEFT, KC_DOWN, KC_UP,   KC_RIGHT,_______, _______},
-        {_______, _______, KC_CUT,  KC_COPY, KC_PASTE,_______,    KC_HOME, KC_PGDN, KC_PGUP, KC_END,  _______, _______},
-        {_______, _______, MO(_ADJUST), _______, _______, _______,    _______, _______, _______, _______, _______, _______}
-    },
-    
-    [_ADJUST] = {
-        {RESET,   _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, RESET},
-        {_______, _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, _______},
-        {_______, _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, _______},
-        {_______, _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, _______}
-    },
+// Keymap - 4 rows x 12 columns (6 per half), laid out in keymap_layout.h
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] HOT_DATA(keymaps) = KEYMAP_LAYOUT;
 
-    // Mouse layer - WASD for movement, Q/E for clicks, R/F for auto-clicker
-    [_MOUSE] = {
-        // Left Half                                              // Right Half
-        {KC_MS_ACCEL0, KC_MS_BTN1, KC_MS_WH_UP, KC_MS_BTN2, KC_AC_LEFT, KC_AC_TOGGLE,    KC_MS_WH_UP, KC_MS_WH_LEFT, KC_MS_UP, KC_MS_WH_RIGHT, KC_MS_BTN4, KC_MS_ACCEL2},
-        {KC_MS_ACCEL1, KC_MS_BTN3, KC_MS_WH_DOWN, KC_AC_RIGHT, KC_AC_FASTER, KC_AC_SLOWER,  KC_MS_WH_DOWN, KC_MS_LEFT, KC_MS_DOWN, KC_MS_RIGHT, KC_MS_BTN5, _______},
-        {_______,    _______,   _______,   _______,   _______,   _______,    _______,  _______,  _______,  _______,  _______,  _______},
-        {_______,    _______,   _______,   KC_MS_BTN1, KC_MS_BTN2, _______,    KC_MS_BTN1, _______, _______, _______, _______, _______}
-    }
-};
+const uint8_t keymap_layer_count = sizeof(keymaps) / sizeof(keymaps[0]);
 
+#if COMBO_ENABLE
 // Combo definitions - define the actual key combinations
 // const uint16_t PROGMEM combo_jk[] = {KC_J, KC_K, COMBO_END};
 // const uint16_t PROGMEM combo_df[] = {KC_D, KC_F, COMBO_END};
@@ -99,8 +42,11 @@ const uint16_t combo_as[] = {KC_A, KC_S, COMBO_END};
 const uint16_t combo_qw[] = {KC_Q, KC_W, COMBO_END};
 const uint16_t combo_op[] = {KC_O, KC_P, COMBO_END};
 
-// Combo array - maps combinations to output keycodes
-const combo_t key_combos[] = {
+// Combo array - maps combinations to output keycodes. On every layer the
+// combo is active on, any positions carrying its keys there trigger it.
+// Optional trailing fields set a per-combo term in ms and a layer mask,
+// e.g. {combo_jk, 2, KC_ESC, 50, 1 << _QWERT}
+const combo_t key_combos[] HOT_DATA(key_combos) = {
     {combo_jk, 2, KC_ESC},    // J+K = ESC
     {combo_df, 2, KC_TAB},    // D+F = TAB
     {combo_sd, 2, KC_CAPS},   // S+D = CAPS LOCK
@@ -110,7 +56,11 @@ const combo_t key_combos[] = {
     {combo_op, 2, KC_BSPC},   // O+P = BACKSPACE
 };
 
-const uint8_t combo_count = sizeof(key_combos) / sizeof(combo_t);
+const uint16_t combo_count = sizeof(key_combos) / sizeof(combo_t);
+_Static_assert(sizeof(key_combos) / sizeof(combo_t) <= MAX_COMBOS, "More combos than MAX_COMBOS");
+#endif
+
+#if TAPDANCE_ENABLE
 
 // Tap Dance implementations
 void td_esc_caps_finished(uint8_t count) {
@@ -173,7 +123,7 @@ void td_spc_ent_reset(uint8_t count) {
 }
 
 // Tap Dance definitions array
-const tap_dance_action_t tap_dance_actions[] = {
+const tap_dance_action_t tap_dance_actions[] HOT_DATA(tap_dance_actions) = {
     [TD_ESC_CAPS] = {
         .kc_single = KC_ESC,
         .kc_double = KC_CAPS,
@@ -190,26 +140,65 @@ const tap_dance_action_t tap_dance_actions[] = {
         .kc_single = KC_Q,
         .kc_double = KC_ESC,
         .on_dance_finished = NULL,  // Use default behavior
-        .on_reset = NULL
+        .on_reset = NULL,
+        .kc_hold = KC_LCTL,         // Hold for Ctrl
+        .term = 175
     }
 };
 
+const uint8_t tap_dance_count = sizeof(tap_dance_actions) / sizeof(tap_dance_action_t);
+_Static_assert(sizeof(tap_dance_actions) / sizeof(tap_dance_action_t) == TAP_DANCE_COUNT,
+               "One tap dance action per entry in enum tap_dances");
+#endif
+
+#if MODTAP_ENABLE
+// Mod-taps that tap at once when pressed mid typing streak. Only list keys
+// that are never chorded quickly, e.g. CTL_T(KC_ESC) if Ctrl+letter is
+// always typed with a pause first.
+const uint16_t modtap_streak_keys[] HOT_DATA(modtap_streak_keys) = {
+    KC_NO
+};
+#endif
+
+// Macros, played back by the sequencer in macro.c
+static const uint8_t macro_hello[] = {
+    MACRO_TAP(KC_H), MACRO_TAP(KC_E), MACRO_TAP(KC_L), MACRO_TAP(KC_L), MACRO_TAP(KC_O),
+    MACRO_OP_END
+};
+
+static const uint8_t macro_ctrl_c[] = {
+    MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_C)),
+    MACRO_OP_END
+};
+
+// Shortcut keycodes KC_COPY..KC_REDO, in keycode order. Each row is a
+// whole macro, so it needs its own MACRO_OP_END.
+static const uint8_t macro_shortcuts[][7] = {
+    { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_C)), MACRO_OP_END },  // KC_COPY
+    { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_V)), MACRO_OP_END },  // KC_PASTE
+    { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_X)), MACRO_OP_END },  // KC_CUT
+    { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_Z)), MACRO_OP_END },  // KC_UNDO
+    { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_Y)), MACRO_OP_END }   // KC_REDO
+};
+_Static_assert(sizeof(macro_shortcuts) / sizeof(macro_shortcuts[0]) == KC_REDO - KC_COPY + 1,
+               "One shortcut macro per keycode KC_COPY..KC_REDO");
+
+const uint8_t *const keymap_macros[] = {
+    [M_HELLO] = macro_hello,
+    [M_CTRL_C] = macro_ctrl_c
+};
+
+const uint8_t keymap_macro_count = sizeof(keymap_macros) / sizeof(keymap_macros[0]);
+_Static_assert(sizeof(keymap_macros) / sizeof(keymap_macros[0]) == MACRO_COUNT,
+               "One macro per entry in enum keymap_macro_ids");
+
 // Process custom keycodes
 bool process_custom_keycode(uint16_t keycode, bool pressed) {
     switch (keycode) {
         case CUSTOM_1:
             if (pressed) {
-                // Custom macro example - types "Hello World"
-                register_key(KC_H);
-                unregister_key(KC_H);
-                register_key(KC_E);
-                unregister_key(KC_E);
-                register_key(KC_L);
-                unregister_key(KC_L);
-                register_key(KC_L);
-                unregister_key(KC_L);
-                register_key(KC_O);
-                unregister_key(KC_O);
+                // Custom macro example - types "hello"
+                macro_play(macro_hello);
             }
             return false;
             
@@ -223,11 +212,8 @@ bool process_custom_keycode(uint16_t keycode, bool pressed) {
             
         case CUSTOM_3:
             if (pressed) {
-                // Example: Complex macro
-                register_modifier(KC_LCTL);
-                register_key(KC_C);
-                unregister_key(KC_C);
-                unregister_modifier(KC_LCTL);
+                // Example: Ctrl+C
+                macro_play(macro_ctrl_c);
             }
             return false;
             
@@ -236,77 +222,137 @@ bool process_custom_keycode(uint16_t keycode, bool pressed) {
     }
 }
 
-// Main key processing function (called from dongle/main.c)
-void process_key_event(uint8_t row, uint8_t col, bool pressed) {
-    uint8_t layer = get_highest_layer();
-    uint16_t keycode = get_keycode_at(layer, row, col);
+// Process the shared shortcut keycodes (KC_COPY etc.)
+static bool process_shortcut_keycode(uint16_t keycode, bool pressed) {
+    if (keycode < KC_COPY || keycode > KC_REDO) return true;
     
-    // Process custom keycodes first
-    if ((keycode & 0xFF00) == 0x7000) {
-        if (!process_custom_keycode(keycode, pressed)) {
-            return;
-        }
-    }
-    
-    // Process mouse keycodes
-    if ((keycode & 0xFF00) == 0x7100) {
-        if (!process_mouse_keycode(keycode, pressed)) {
-            return;
-        }
-    }
-    
-    // Process auto-clicker keycodes
-    if ((keycode & 0xFF00) == 0x7200) {
-        if (!process_autoclicker_keycode(keycode, pressed)) {
-            return;
-        }
+    if (pressed) {
+        macro_play(macro_shortcuts[keycode - KC_COPY]);
     }
-    
-    // Process through feature pipeline
-    if (!process_combo(keycode, pressed)) return;
-    if (!process_tap_dance(keycode, pressed, row, col)) return;
-    if (!process_modtap(keycode, pressed, row, col)) return;
-    if (!process_layer_keycode(keycode, pressed)) return;
-    if (!process_oneshot_layer(keycode, pressed)) return;
-    
-    // Handle special keycodes
-    if (keycode == RESET && pressed) {
+    return false;
+}
+
+// Pipeline stages - thin adapters over the feature processors
+static pipeline_result_t HOT_PATH(stage_result)(bool continue_processing) {
+    return continue_processing ? PIPELINE_CONTINUE : PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t HOT_PATH(layer_stage)(key_event_t *event) {
+    return stage_result(process_layer_keycode(event->keycode, event->pressed));
+}
+
+static pipeline_result_t custom_stage(key_event_t *event) {
+    if (!process_shortcut_keycode(event->keycode, event->pressed)) return PIPELINE_CONSUMED;
+    process_custom_keycode(event->keycode, event->pressed);
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t mouse_stage(key_event_t *event) {
+    process_mouse_keycode(event->keycode, event->pressed);
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t macro_stage(key_event_t *event) {
+    process_macro_keycode(event->keycode, event->pressed);
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t autoclicker_stage(key_event_t *event) {
+    process_autoclicker_keycode(event->keycode, event->pressed);
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t system_stage(key_event_t *event) {
+    if (event->keycode == RESET && event->pressed) {
+        macro_stop();
         clear_keyboard();
-        return;
     }
-    
-    // Finally, send normal key
-    if (pressed) {
-        register_key(keycode);
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t HOT_PATH(basic_stage)(key_event_t *event) {
+    if (event->pressed) {
+        register_key(event->keycode);
     } else {
-        unregister_key(keycode);
+        unregister_key(event->keycode);
     }
+    return PIPELINE_CONSUMED;
+}
+
+// Register the stages in priority order
+static void register_pipeline(void) {
+    pipeline_init();
+    tap_hold_init();
     
+    // Combos and tap-hold decisions see every key so they can hold back
+    // the keys that follow until they are decided
+#if COMBO_ENABLE
+    combos_set_stage(pipeline_register("combo", process_combo, PIPELINE_ALL_KEYS));
+#endif
+    tap_hold_set_stage(pipeline_register("taphold", process_tap_hold, PIPELINE_ALL_KEYS));
+    
+    pipeline_register("layer", layer_stage, PIPELINE_CLASS(KC_CLASS_LAYER));
+#if ONESHOT_ENABLE
+    pipeline_register("oneshot", process_oneshot,
+                      PIPELINE_CLASS(KC_CLASS_ONESHOT) | PIPELINE_CLASS(KC_CLASS_BASIC) |
+                      PIPELINE_CLASS(KC_CLASS_SYSTEM) | PIPELINE_CLASS(KC_CLASS_CUSTOM) |
+                      PIPELINE_CLASS(KC_CLASS_MOUSE) | PIPELINE_CLASS(KC_CLASS_AUTOCLICKER) |
+                      PIPELINE_CLASS(KC_CLASS_MACRO));
+#endif
+#if DYNAMIC_MACRO_ENABLE
+    pipeline_register("dynmacro", process_dynamic_macro,
+                      PIPELINE_CLASS(KC_CLASS_CUSTOM) | PIPELINE_CLASS(KC_CLASS_BASIC));
+#endif
+    pipeline_register("custom", custom_stage, PIPELINE_CLASS(KC_CLASS_CUSTOM));
+    pipeline_register("macro", macro_stage, PIPELINE_CLASS(KC_CLASS_MACRO));
+    pipeline_register("mouse", mouse_stage, PIPELINE_CLASS(KC_CLASS_MOUSE));
+    pipeline_register("autoclicker", autoclicker_stage, PIPELINE_CLASS(KC_CLASS_AUTOCLICKER));
+    pipeline_register("system", system_stage, PIPELINE_CLASS(KC_CLASS_SYSTEM));
+    pipeline_register("basic", basic_stage, PIPELINE_CLASS(KC_CLASS_BASIC));
+}
+
+// Main key processing function for a single key transition
+void process_key_event(uint8_t row, uint8_t col, bool pressed) {
+    pipeline_process_key(row, col, pressed, DEVICE_DONGLE);
     send_hid_report();
 }
 
-// Feature flags getter
+// Feature flags getter - the features this firmware was built with
 uint32_t get_feature_flags(void) {
-    return FEATURE_MODTAP | FEATURE_LAYERS | FEATURE_ONESHOT | 
-           FEATURE_COMBOS | FEATURE_TAPDANCE;
+    return (MODTAP_ENABLE ? FEATURE_MODTAP : 0) |
+           FEATURE_LAYERS |
+           (ONESHOT_ENABLE ? FEATURE_ONESHOT : 0) |
+           (COMBO_ENABLE ? FEATURE_COMBOS : 0) |
+           (TAPDANCE_ENABLE ? FEATURE_TAPDANCE : 0) |
+           (DYNAMIC_MACRO_ENABLE ? FEATURE_DYNAMIC_MACRO : 0) |
+           (ADAPTIVE_TERM_ENABLE ? FEATURE_ADAPTIVE_TERM : 0);
 }
 
 // Initialize all features
 void init_features(void) {
+    deadline_init();
     layers_init();
+#if COMBO_ENABLE
     init_combos();
+#endif
+    macro_init();
+#if DYNAMIC_MACRO_ENABLE
+    dynamic_macro_init();
+#endif
+#if ADAPTIVE_TERM_ENABLE
+    adaptive_term_init();
+#endif
+    register_pipeline();
     // Other feature inits handled by their respective modules
 }
 
-// Run periodic feature tasks
+// Run feature timeouts that have come due
 void features_task(void) {
-    modtap_task();
-    tap_dance_task();
-    oneshot_task();
+    deadline_task();
 }
 
 // Optional: LED indicator update based on layer
-void update_layer_leds(uint8_t layer_state) {
+void update_layer_leds(layer_state_t layer_state) {
     // This would be called on the keyboard halves to update LED indicators
     // Example implementation:
     /*
@@ -339,19 +385,3 @@ uint32_t get_layer_color(uint8_t layer) {
             return 0x000000;  // Off
     }
 }
-
-// Helper function for RESET keycode
-#define RESET 0x5C00
-
-// Additional helper macros for common key combinations
-#define KC_COPY  LCTL(KC_C)
-#define KC_PASTE LCTL(KC_V)
-#define KC_CUT   LCTL(KC_X)
-#define KC_UNDO  LCTL(KC_Z)
-#define KC_REDO  LCTL(KC_Y)
-
-// Simplified modifier key combinations
-#define LCTL(kc) (KC_LCTL | ((kc) << 8))
-#define LSFT(kc) (KC_LSFT | ((kc) << 8))
-#define LALT(kc) (KC_LALT | ((kc) << 8))
-#define LGUI(kc) (KC_LGUI | ((kc) << 8))
@@ -0,0 +1,93 @@
+// /keymaps/default/keymap_layout.h
+// Layout shared by keymap.c and the compile-time checks in keymap_tables.cpp
+#ifndef KEYMAP_LAYOUT_H
+#define KEYMAP_LAYOUT_H
+
+#include "config.h"
+#include "keycodes.h"
+
+// Define layers
+enum layers {
+    _BASE,
+    _QWERT,
+    _LOWER,
+    _RAISE,
+    _ADJUST,
+    _MOUSE,
+    LAYER_COUNT
+};
+
+// Define tap dance indices
+enum tap_dances {
+    TD_ESC_CAPS,
+    TD_SPC_ENT,
+    TD_Q_ESC,
+    TAP_DANCE_COUNT
+};
+
+// Custom keycodes (if needed)
+enum custom_keycodes {
+    CUSTOM_1 = SAFE_RANGE,
+    CUSTOM_2,
+    CUSTOM_3,
+    CUSTOM_KEYCODE_END
+};
+
+// Macro indices for MACRO(n)
+enum keymap_macro_ids {
+    M_HELLO,
+    M_CTRL_C,
+    MACRO_COUNT
+};
+
+// Keymap - 4 rows x 12 columns (6 per half), one block per layer in
+// enum layers order. Comments inside the macro must be /* */.
+#define KEYMAP_LAYOUT { \
+    /* _BASE */ { \
+        /* Left Half                                  Right Half */ \
+        {KC_A, KC_B, KC_C, KC_D, KC_E, KC_F,       KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC}, \
+        {KC_G, KC_H, KC_I, KC_J, KC_K, KC_L,              KC_H,    KC_J,    KC_K,    KC_L,    KC_SCLN, KC_QUOT}, \
+        {KC_M, KC_N, KC_O, KC_P, KC_Q, KC_R,       KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, KC_RSFT}, \
+        {KC_S, KC_T, KC_U, KC_V, KC_W, KC_X,    KC_ENT, MO(_RAISE), KC_RALT, KC_RGUI, OSL(_ADJUST), TD(TD_ESC_CAPS)} \
+    }, \
+ \
+    /* _QWERT */ { \
+        /* Left Half                                  Right Half */ \
+        {KC_TAB,  KC_Q,    KC_W,    KC_E,    KC_R,    KC_T,       KC_Y,    KC_U,    KC_I,    KC_O,    KC_P,    KC_BSPC}, \
+        {CTL_T(KC_ESC), KC_A, KC_S, KC_D, KC_F, KC_G,              KC_H,    KC_J,    KC_K,    KC_L,    KC_SCLN, KC_QUOT}, \
+        {KC_LSFT, KC_Z,    KC_X,    KC_C,    KC_V,    KC_B,       KC_N,    KC_M,    KC_COMM, KC_DOT,  KC_SLSH, KC_RSFT}, \
+        {KC_LGUI, KC_LALT, MO(_LOWER), KC_SPC, TD(TD_SPC_ENT), MO(_RAISE),    KC_ENT, MO(_RAISE), KC_RALT, KC_RGUI, OSL(_ADJUST), TD(TD_ESC_CAPS)} \
+    }, \
+ \
+    /* _LOWER */ { \
+        {KC_GRV,  KC_1,    KC_2,    KC_3,    KC_4,    KC_5,       KC_6,    KC_7,    KC_8,    KC_9,    KC_0,    KC_DEL}, \
+        {_______, KC_F1,   KC_F2,   KC_F3,   KC_F4,   KC_F5,      KC_F6,   KC_MINS, KC_EQL,  KC_LBRC, KC_RBRC, KC_BSLS}, \
+        {_______, KC_F7,   KC_F8,   KC_F9,   KC_F10,  KC_F11,     KC_F12,  KC_HOME, KC_END,  KC_PGUP, KC_PGDN, _______}, \
+        {_______, _______, _______, _______, _______, _______,    _______, MO(_ADJUST), _______, _______, _______, _______} \
+    }, \
+ \
+    /* _RAISE */ { \
+        {KC_GRV,  KC_EXLM, KC_AT,   KC_HASH, KC_DLR,  KC_PERC,    KC_CIRC, KC_AMPR, KC_ASTR, KC_LPRN, KC_RPRN, KC_DEL}, \
+        {_______, _______, _______, _______, _______, _______,    KC_LEFT, KC_DOWN, KC_UP,   KC_RIGHT,_______, _______}, \
+        {_______, _______, KC_CUT,  KC_COPY, KC_PASTE,_______,    KC_HOME, KC_PGDN, KC_PGUP, KC_END,  _______, _______}, \
+        {_______, _______, MO(_ADJUST), _______, _______, _______,    _______, _______, _______, _______, _______, _______} \
+    }, \
+ \
+    /* _ADJUST */ { \
+        {RESET,   _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, RESET}, \
+        {MACRO(M_HELLO), MACRO(M_CTRL_C), _______, _______, _______, _______,    _______, _______, _______, _______, _______, _______}, \
+        {DM_REC1, DM_REC2, DM_RSTP, DM_PLY1, DM_PLY2, _______,    _______, _______, _______, _______, _______, OSM(MOD_RSFT)}, \
+        {_______, _______, _______, _______, _______, _______,    _______, _______, _______, _______, _______, _______} \
+    }, \
+ \
+    /* Mouse layer - WASD for movement, Q/E for clicks, R/F for auto-clicker */ \
+    /* _MOUSE */ { \
+        /* Left Half                                  Right Half */ \
+        {KC_MS_ACCEL0, KC_MS_BTN1, KC_MS_WH_UP, KC_MS_BTN2, KC_AC_LEFT, KC_AC_TOGGLE,    KC_MS_WH_UP, KC_MS_WH_LEFT, KC_MS_UP, KC_MS_WH_RIGHT, KC_MS_BTN4, KC_MS_ACCEL2}, \
+        {KC_MS_ACCEL1, KC_MS_BTN3, KC_MS_WH_DOWN, KC_AC_RIGHT, KC_AC_FASTER, KC_AC_SLOWER,  KC_MS_WH_DOWN, KC_MS_LEFT, KC_MS_DOWN, KC_MS_RIGHT, KC_MS_BTN5, _______}, \
+        {_______,    _______,   _______,   _______,   _______,   _______,    _______,  _______,  _______,  _______,  _______,  _______}, \
+        {_______,    _______,   _______,   KC_MS_BTN1, KC_MS_BTN2, _______,    KC_MS_BTN1, _______, _______, _______, _______, _______} \
+    } \
+}
+
+#endif // KEYMAP_LAYOUT_H
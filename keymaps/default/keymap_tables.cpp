@@ -0,0 +1,125 @@
+// /keymaps/default/keymap_tables.cpp
+// Checks the keymap at compile time and builds the tables the runtime
+// would otherwise work out per event. A failed check reports the
+// offending cell as layer * MATRIX_ROWS * KEYMAP_COLS + row * KEYMAP_COLS + col.
+#include <stdint.h>
+#include "config.h"
+#include "keycodes.h"
+#include "keymap_layout.h"
+#include "keymap_tables.h"
+#include "hot_path.h"
+
+namespace {
+
+constexpr uint16_t layout[][MATRIX_ROWS][KEYMAP_COLS] = KEYMAP_LAYOUT;
+constexpr int layer_count = sizeof(layout) / sizeof(layout[0]);
+constexpr int cells = MATRIX_ROWS * KEYMAP_COLS;
+constexpr int no_cell = -1;
+
+static_assert(layer_count == LAYER_COUNT, "KEYMAP_LAYOUT needs one block per entry in enum layers");
+static_assert(layer_count <= MAX_LAYERS, "More layers than MAX_LAYERS");
+static_assert(TAP_DANCE_COUNT <= MAX_TAP_DANCE, "More tap dances than MAX_TAP_DANCE");
+static_assert(MACRO_COUNT <= 0x100, "MACRO(n) takes an 8-bit index");
+
+// Keycode families, each owning one high byte (mod-taps own 0xE0-0xE7)
+constexpr uint16_t family_prefixes[] = {
+    MO(0), TG(0), TO(0), TT(0), OSL(0), TD(0), OSM(0), RESET,
+    KC_COPY & 0xFF00, KC_MS_UP & 0xFF00, KC_AC_TOGGLE & 0xFF00, MACRO(0)
+};
+
+constexpr bool prefixes_distinct() {
+    constexpr int count = sizeof(family_prefixes) / sizeof(family_prefixes[0]);
+    for (int i = 0; i < count; i++) {
+        uint8_t high = family_prefixes[i] >> 8;
+        if (high == 0x00 || (high >= KC_LCTL && high <= KC_RGUI)) return false;
+        for (int j = i + 1; j < count; j++) {
+            if (family_prefixes[i] == family_prefixes[j]) return false;
+        }
+    }
+    return true;
+}
+
+static_assert(prefixes_distinct(), "Keycode families overlap");
+static_assert(DM_PLY2 < SAFE_RANGE, "Built-in custom keycodes run into SAFE_RANGE");
+static_assert(CUSTOM_KEYCODE_END <= (KC_COPY | 0xFF), "Custom keycodes overflow the 0x70xx range");
+
+constexpr bool keycode_valid(uint16_t keycode) {
+    uint8_t high = keycode >> 8;
+    uint8_t low = keycode & 0xFF;
+    
+    if (high == 0x00) return true;
+    if (high >= KC_LCTL && high <= KC_RGUI) return true;  // MT(mod, kc)
+    
+    switch (keycode & 0xFF00) {
+        case MO(0):
+        case TG(0):
+        case TO(0):
+        case TT(0):
+        case OSL(0):
+            return low < LAYER_COUNT;
+        case TD(0):
+            return low < TAP_DANCE_COUNT;
+        case OSM(0):
+            return low != 0;
+        case MACRO(0):
+            return low < MACRO_COUNT;
+        case RESET:
+            return keycode == RESET;
+        case KC_COPY & 0xFF00:
+            return (keycode >= KC_COPY && keycode <= DM_PLY2) ||
+                   (keycode >= SAFE_RANGE && keycode < CUSTOM_KEYCODE_END);
+        case KC_MS_UP & 0xFF00:
+        case KC_AC_TOGGLE & 0xFF00:
+            return true;
+        default:
+            return false;
+    }
+}
+
+constexpr int first_invalid_cell() {
+    for (int layer = 0; layer < layer_count; layer++) {
+        for (int row = 0; row < MATRIX_ROWS; row++) {
+            for (int col = 0; col < KEYMAP_COLS; col++) {
+                if (!keycode_valid(layout[layer][row][col])) {
+                    return layer * cells + row * KEYMAP_COLS + col;
+                }
+            }
+        }
+    }
+    return no_cell;
+}
+
+// Nothing lies below the base layer for a transparent key to fall to
+constexpr int first_transparent_base_cell() {
+    for (int row = 0; row < MATRIX_ROWS; row++) {
+        for (int col = 0; col < KEYMAP_COLS; col++) {
+            if (layout[0][row][col] == KC_TRNS) return row * KEYMAP_COLS + col;
+        }
+    }
+    return no_cell;
+}
+
+static_assert(first_invalid_cell() == no_cell,
+              "Keymap has an unknown keycode or an out-of-range layer, tap dance or macro index");
+static_assert(first_transparent_base_cell() == no_cell,
+              "Base layer has a transparent key");
+
+constexpr keymap_defined_t build_defined_layers() {
+    keymap_defined_t table{};
+    for (int layer = 0; layer < layer_count; layer++) {
+        for (int row = 0; row < MATRIX_ROWS; row++) {
+            for (int col = 0; col < KEYMAP_COLS; col++) {
+                if (layout[layer][row][col] != KC_TRNS) {
+                    table.layers[row][col] |= (layer_state_t)1 << layer;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr keymap_defined_t defined_layers = build_defined_layers();
+
+}  // namespace
+
+extern "C" const keymap_defined_t keymap_defined_layers HOT_DATA(keymap_defined_layers) = defined_layers;
@@ -0,0 +1,119 @@
+#include "adaptive_term.h"
+#include "config.h"
+#include "timer.h"
+#include "deadline.h"
+#include "persist.h"
+#include <string.h>
+
+#define ADAPTIVE_TERM_MAGIC 0x4D524554  // "TERM"
+
+static uint8_t tap_histogram[TAP_HOLD_POSITIONS][ADAPTIVE_TERM_BUCKETS];
+static uint8_t hold_histogram[TAP_HOLD_POSITIONS][ADAPTIVE_TERM_BUCKETS];
+static uint16_t tap_samples[TAP_HOLD_POSITIONS];
+static uint16_t hold_samples[TAP_HOLD_POSITIONS];
+
+static uint16_t terms[TAP_HOLD_POSITIONS];  // Learned term per key position, ms
+
+static void save_terms(void *ctx);
+static deadline_t save_deadline = DEADLINE_INIT(save_terms, NULL);
+
+static inline uint16_t clamp_term(uint32_t term_ms) {
+    if (term_ms < ADAPTIVE_TERM_MIN) return ADAPTIVE_TERM_MIN;
+    if (term_ms > ADAPTIVE_TERM_MAX) return ADAPTIVE_TERM_MAX;
+    return term_ms;
+}
+
+void adaptive_term_init(void) {
+    memset(tap_histogram, 0, sizeof(tap_histogram));
+    memset(hold_histogram, 0, sizeof(hold_histogram));
+    memset(tap_samples, 0, sizeof(tap_samples));
+    memset(hold_samples, 0, sizeof(hold_samples));
+    
+    if (persist_load(ADAPTIVE_TERM_MAGIC, terms, sizeof(terms))) {
+        for (uint8_t i = 0; i < TAP_HOLD_POSITIONS; i++) {
+            terms[i] = clamp_term(terms[i]);
+        }
+    } else {
+        for (uint8_t i = 0; i < TAP_HOLD_POSITIONS; i++) {
+            terms[i] = TAPPING_TERM;
+        }
+    }
+}
+
+// Bucket counts are halved when one fills, so old samples fade out
+static void add_sample(uint8_t *histogram, uint16_t *samples, uint32_t duration_ms) {
+    uint32_t bucket = duration_ms / ADAPTIVE_TERM_BUCKET_MS;
+    if (bucket >= ADAPTIVE_TERM_BUCKETS) bucket = ADAPTIVE_TERM_BUCKETS - 1;
+    
+    if (histogram[bucket] == UINT8_MAX) {
+        *samples = 0;
+        for (uint8_t i = 0; i < ADAPTIVE_TERM_BUCKETS; i++) {
+            histogram[i] /= 2;
+            *samples += histogram[i];
+        }
+    }
+    
+    histogram[bucket]++;
+    (*samples)++;
+}
+
+// First bucket by which `percent` of the samples are covered
+static uint8_t percentile_bucket(const uint8_t *histogram, uint16_t samples, uint8_t percent) {
+    uint32_t target = ((uint32_t)samples * percent + 99) / 100;
+    uint32_t covered = 0;
+    
+    for (uint8_t i = 0; i < ADAPTIVE_TERM_BUCKETS; i++) {
+        covered += histogram[i];
+        if (covered >= target) return i;
+    }
+    return ADAPTIVE_TERM_BUCKETS - 1;
+}
+
+static void update_term(uint8_t position) {
+    if (tap_samples[position] < ADAPTIVE_TERM_MIN_SAMPLES) return;
+    
+    uint8_t tap_bucket = percentile_bucket(tap_histogram[position], tap_samples[position], 95);
+    uint32_t longest_tap_ms = (tap_bucket + 1) * ADAPTIVE_TERM_BUCKET_MS;
+    uint16_t term = clamp_term(longest_tap_ms + ADAPTIVE_TERM_MARGIN);
+    
+    // Holds as short as the taps - no term separates them, stay safe
+    if (hold_samples[position] >= ADAPTIVE_TERM_MIN_SAMPLES) {
+        uint8_t hold_bucket = percentile_bucket(hold_histogram[position], hold_samples[position], 5);
+        if (hold_bucket <= tap_bucket) term = TAPPING_TERM;
+    }
+    
+    if (term != terms[position]) {
+        terms[position] = term;
+        deadline_schedule(&save_deadline,
+                          timer_read_us() + TIMER_MS_TO_US(ADAPTIVE_TERM_SAVE_DELAY));
+    }
+}
+
+uint16_t adaptive_term_get(const key_event_t *event) {
+    return terms[event->row * KEYMAP_COLS + event->col];
+}
+
+void adaptive_term_observe(const key_event_t *press, bool hold, uint32_t held_us) {
+    uint8_t position = press->row * KEYMAP_COLS + press->col;
+    uint32_t held_ms = held_us / 1000;
+    
+    if (hold) {
+        add_sample(hold_histogram[position], &hold_samples[position], held_ms);
+    } else {
+        add_sample(tap_histogram[position], &tap_samples[position], held_ms);
+    }
+    update_term(position);
+}
+
+// Terms have settled - keep them across power cycles
+static void save_terms(void *ctx) {
+    (void)ctx;
+    persist_save(ADAPTIVE_TERM_MAGIC, terms, sizeof(terms));
+}
+
+void get_adaptive_term_info(uint8_t row, uint8_t col, adaptive_term_info_t *info) {
+    uint8_t position = row * KEYMAP_COLS + col;
+    info->term_ms = terms[position];
+    info->taps = tap_samples[position];
+    info->holds = hold_samples[position];
+}
@@ -0,0 +1,36 @@
+#ifndef ADAPTIVE_TERM_H
+#define ADAPTIVE_TERM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pipeline.h"
+#include "tap_hold.h"
+
+// Per-key tapping terms learned from how long the key is held for taps
+// and for holds. Each key keeps a histogram of both; once it has enough
+// taps its term becomes the 95th percentile tap plus a margin, kept
+// within ADAPTIVE_TERM_MIN..ADAPTIVE_TERM_MAX. Keys whose holds are as
+// short as their taps keep TAPPING_TERM.
+
+#define ADAPTIVE_TERM_BUCKET_MS   16
+#define ADAPTIVE_TERM_BUCKETS     32  // Last bucket collects everything longer
+#define ADAPTIVE_TERM_MIN_SAMPLES 20
+#define ADAPTIVE_TERM_MARGIN      40  // ms above the tap percentile
+#define ADAPTIVE_TERM_SAVE_DELAY  60000  // ms of no changes before saving to flash
+
+typedef struct {
+    uint16_t term_ms;
+    uint16_t taps;   // Samples currently in the histograms
+    uint16_t holds;
+} adaptive_term_info_t;
+
+// Load learned terms from flash
+void adaptive_term_init(void);
+
+// tap_hold_behavior_t hooks
+uint16_t adaptive_term_get(const key_event_t *event);
+void adaptive_term_observe(const key_event_t *press, bool hold, uint32_t held_us);
+
+void get_adaptive_term_info(uint8_t row, uint8_t col, adaptive_term_info_t *info);
+
+#endif // ADAPTIVE_TERM_H
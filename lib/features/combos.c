@@ -1,85 +1,400 @@
+#include <string.h>
 #include "combos.h"
+#include "layers.h"
 #include "timer.h"
+#include "deadline.h"
 #include "config.h"
-#include "usb_hid.h"  // This include
+#include "usb_hid.h"
+#include "hot_path.h"
 
 extern const combo_t key_combos[];
-extern const uint8_t combo_count;
+extern const uint16_t combo_count;
 
+// One placement of a combo: the positions that trigger it and the layers
+// on which they do
 typedef struct {
-    bool active;
-    uint32_t timer;
-    uint16_t pressed_keys[8];
-    uint8_t pressed_count;
-} combo_state_t;
-
-static combo_state_t combo_state = {0};
-
-bool process_combo(uint16_t keycode, bool pressed) {
-    if (!pressed) {
-        // Check if releasing a combo key
-        for (uint8_t i = 0; i < combo_state.pressed_count; i++) {
-            if (combo_state.pressed_keys[i] == keycode) {
-                // Combo interrupted by release
-                combo_state.active = false;
-                combo_state.pressed_count = 0;
-                return true;
+    uint64_t mask;
+    layer_state_t layers;
+    uint32_t term_us;
+    uint16_t combo;
+} combo_variant_t;
+
+// Fired combo whose output is held until one of its keys is released
+typedef struct {
+    uint64_t held;     // Combo keys still physically held
+    uint16_t variant;
+    uint8_t row, col;  // Where the output was pressed, for its release
+    bool output_held;
+} active_combo_t;
+
+typedef struct {
+    key_event_t events[COMBO_MAX_KEYS];  // Deferred presses in arrival order
+    uint8_t count;
+    uint64_t mask;
+    uint32_t start_us;
+    uint32_t deadline_us;
+    int16_t matched;   // Best complete variant so far, -1 = none
+} combo_buffer_t;
+
+// Positions carrying each key of a combo on one layer
+typedef struct {
+    uint64_t positions[COMBO_MAX_KEYS];
+    uint16_t combo;
+    uint16_t first_variant;  // The combo's variants start here
+    uint8_t key_count;
+    uint8_t layer;
+} combo_placement_t;
+
+static combo_variant_t variants[COMBO_MAX_VARIANTS];
+static uint16_t variant_count = 0;
+static combo_stats_t combo_stats;
+
+// Candidate variants per position, packed: candidates[start[p] .. start[p+1])
+static uint16_t candidate_start[COMBO_POSITIONS + 1];
+static uint16_t candidates[COMBO_MAX_VARIANTS * COMBO_MAX_KEYS];
+
+static combo_buffer_t buffer = { .matched = -1 };
+static active_combo_t active[COMBO_MAX_ACTIVE];
+static uint8_t combo_stage = PIPELINE_NO_STAGE;
+
+static void combo_expired(void *ctx);
+static deadline_t combo_deadline = DEADLINE_INIT(combo_expired, NULL);
+
+static inline uint64_t position_bit(uint8_t row, uint8_t col) {
+    return 1ull << (row * KEYMAP_COLS + col);
+}
+
+// Every position carrying the keycode on the given layer
+static uint64_t find_positions(uint8_t layer, uint16_t keycode) {
+    uint64_t positions = 0;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < KEYMAP_COLS; col++) {
+            if (get_keycode_at(layer, row, col) == keycode) {
+                positions |= position_bit(row, col);
             }
         }
-        return true;
+    }
+    return positions;
+}
+
+// Record a set of positions for the combo, merging it with the same set
+// found on another layer
+static bool add_variant(const combo_placement_t *placement, uint64_t mask) {
+    layer_state_t layer_bit = (layer_state_t)1 << placement->layer;
+    
+    for (uint16_t v = placement->first_variant; v < variant_count; v++) {
+        if (variants[v].mask == mask) {
+            variants[v].layers |= layer_bit;
+            return true;
+        }
     }
     
-    // Key pressed
-    if (!combo_state.active) {
-        combo_state.active = true;
-        combo_state.timer = timer_read();
-        combo_state.pressed_count = 0;
-    } else if (timer_elapsed(combo_state.timer) > COMBO_TERM) {
-        // Combo window expired
-        combo_state.active = false;
-        combo_state.pressed_count = 0;
-        return true;
+    if (variant_count >= COMBO_MAX_VARIANTS) return false;
+    
+    const combo_t *combo = &key_combos[placement->combo];
+    combo_variant_t *variant = &variants[variant_count++];
+    variant->mask = mask;
+    variant->layers = layer_bit;
+    variant->term_us = TIMER_MS_TO_US(combo->term ? combo->term : COMBO_TERM);
+    variant->combo = placement->combo;
+    return true;
+}
+
+// Every way to put keys `key`.. on distinct positions not yet in `mask`
+static bool place_keys(const combo_placement_t *placement, uint8_t key, uint64_t mask) {
+    if (key == placement->key_count) {
+        return add_variant(placement, mask);
     }
     
-    // Add key to combo state
-    if (combo_state.pressed_count < 8) {
-        combo_state.pressed_keys[combo_state.pressed_count++] = keycode;
+    uint64_t options = placement->positions[key] & ~mask;
+    while (options) {
+        uint64_t bit = options & -options;
+        if (!place_keys(placement, key + 1, mask | bit)) return false;
+        options &= options - 1;
     }
+    return true;
+}
+
+// Resolve a combo's keycodes to position sets on each of its layers
+static bool place_combo(uint16_t c) {
+    const combo_t *combo = &key_combos[c];
+    if (combo->key_count < 2 || combo->key_count > COMBO_MAX_KEYS) return true;
     
-    // Check if this matches any combo
-    for (uint8_t c = 0; c < combo_count; c++) {
-        const combo_t *combo = &key_combos[c];
-        
-        if (combo->key_count != combo_state.pressed_count) continue;
+    layer_state_t all_layers = (keymap_layer_count >= 32) ? ~(layer_state_t)0 :
+                               ((layer_state_t)1 << keymap_layer_count) - 1;
+    layer_state_t layers = combo->layers ? (combo->layers & all_layers) : all_layers;
+    
+    combo_placement_t placement = {
+        .combo = c,
+        .first_variant = variant_count,
+        .key_count = combo->key_count,
+    };
+    
+    while (layers) {
+        placement.layer = __builtin_ctz(layers);
+        layers &= layers - 1;
         
-        bool match = true;
         for (uint8_t i = 0; i < combo->key_count; i++) {
-            bool found = false;
-            for (uint8_t j = 0; j < combo_state.pressed_count; j++) {
-                if (combo->keys[i] == combo_state.pressed_keys[j]) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                match = false;
-                break;
+            placement.positions[i] = find_positions(placement.layer, combo->keys[i]);
+        }
+        if (!place_keys(&placement, 0, 0)) {
+            // Drop the layers already placed too, so the combo is all or nothing
+            variant_count = placement.first_variant;
+            return false;
+        }
+    }
+    return true;
+}
+
+void init_combos(void) {
+    memset(variants, 0, sizeof(variants));
+    memset(candidate_start, 0, sizeof(candidate_start));
+    memset(active, 0, sizeof(active));
+    memset(&combo_stats, 0, sizeof(combo_stats));
+    deadline_cancel(&combo_deadline);
+    buffer.count = 0;
+    buffer.mask = 0;
+    buffer.matched = -1;
+    variant_count = 0;
+    
+    // Combos past MAX_COMBOS are rejected at build time in the keymap
+    uint16_t count = combo_count < MAX_COMBOS ? combo_count : MAX_COMBOS;
+    
+    for (uint16_t c = 0; c < count; c++) {
+        if (!place_combo(c)) {
+            combo_stats.dropped = count - c;  // This combo and every one after it
+            break;
+        }
+    }
+    combo_stats.variants = variant_count;
+    
+    // Count candidates per position, then fill the packed index
+    for (uint16_t v = 0; v < variant_count; v++) {
+        uint64_t mask = variants[v].mask;
+        while (mask) {
+            candidate_start[__builtin_ctzll(mask) + 1]++;
+            mask &= mask - 1;
+        }
+    }
+    for (uint8_t p = 0; p < COMBO_POSITIONS; p++) {
+        candidate_start[p + 1] += candidate_start[p];
+    }
+    
+    uint16_t fill[COMBO_POSITIONS];
+    memcpy(fill, candidate_start, sizeof(fill));
+    for (uint16_t v = 0; v < variant_count; v++) {
+        uint64_t mask = variants[v].mask;
+        while (mask) {
+            candidates[fill[__builtin_ctzll(mask)]++] = v;
+            mask &= mask - 1;
+        }
+    }
+}
+
+void combos_set_stage(uint8_t stage) {
+    combo_stage = stage;
+}
+
+const combo_stats_t *get_combo_stats(void) {
+    return &combo_stats;
+}
+
+// Look for combos on the position that could still complete from `mask`
+// on the current layer. Returns how many need more keys, with the exact
+// match and longest term.
+static uint8_t find_candidates(uint8_t row, uint8_t col, uint64_t mask,
+                               int16_t *exact, uint32_t *term_us) {
+    uint8_t p = row * KEYMAP_COLS + col;
+    layer_state_t layer_bit = (layer_state_t)1 << get_highest_layer();
+    uint8_t open = 0;
+    
+    *exact = -1;
+    *term_us = 0;
+    
+    for (uint16_t i = candidate_start[p]; i < candidate_start[p + 1]; i++) {
+        uint16_t v = candidates[i];
+        const combo_variant_t *variant = &variants[v];
+        
+        // Single subset test against the keys pressed so far
+        if ((variant->mask & mask) != mask) continue;
+        if (!(variant->layers & layer_bit)) continue;
+        
+        if (variant->mask == mask) {
+            *exact = v;
+        } else {
+            open++;
+        }
+        if (variant->term_us > *term_us) {
+            *term_us = variant->term_us;
+        }
+    }
+    
+    return open;
+}
+
+static void HOT_PATH(emit_combo)(uint16_t v, const key_event_t *source, bool pressed) {
+    key_event_t event = *source;
+    event.keycode = key_combos[variants[v].combo].keycode;
+    event.pressed = pressed;
+    event.remapped = true;
+    pipeline_emit(&event, combo_stage);
+}
+
+// Release a fired combo's output at the position it was pressed at, so
+// stages keyed by position see a matching pair whichever key comes up first
+static void HOT_PATH(release_combo)(active_combo_t *combo, const key_event_t *source) {
+    key_event_t event = *source;
+    event.row = combo->row;
+    event.col = combo->col;
+    emit_combo(combo->variant, &event, false);
+    combo->output_held = false;
+}
+
+static void HOT_PATH(fire_combo)(uint16_t v) {
+    const key_event_t *last = &buffer.events[buffer.count - 1];
+    uint64_t combo_mask = variants[v].mask;
+    
+    for (uint8_t i = 0; i < COMBO_MAX_ACTIVE; i++) {
+        if (active[i].held == 0) {
+            active[i].held = combo_mask;
+            active[i].variant = v;
+            active[i].row = last->row;
+            active[i].col = last->col;
+            active[i].output_held = true;
+            emit_combo(v, last, true);
+            return;
+        }
+    }
+    
+    // No free slot - tap the output and swallow the releases
+    emit_combo(v, last, true);
+    emit_combo(v, last, false);
+}
+
+// Settle the buffer: fire the matched combo if there is one, then replay
+// the keys that were not part of it in their original order
+static void HOT_PATH(resolve_buffer)(void) {
+    uint64_t consumed = 0;
+    
+    deadline_cancel(&combo_deadline);
+    
+    if (buffer.matched >= 0) {
+        consumed = variants[buffer.matched].mask;
+        fire_combo(buffer.matched);
+    }
+    
+    uint8_t count = buffer.count;
+    key_event_t events[COMBO_MAX_KEYS];
+    memcpy(events, buffer.events, sizeof(key_event_t) * count);
+    
+    buffer.count = 0;
+    buffer.mask = 0;
+    buffer.matched = -1;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (consumed & position_bit(events[i].row, events[i].col)) continue;
+        pipeline_emit(&events[i], combo_stage);
+    }
+}
+
+// Try to start buffering a fresh press
+static pipeline_result_t HOT_PATH(start_buffer)(key_event_t *event) {
+    int16_t exact;
+    uint32_t term_us;
+    uint64_t bit = position_bit(event->row, event->col);
+    
+    // Combos have at least two keys, so a lone press is never exact
+    if (find_candidates(event->row, event->col, bit, &exact, &term_us) == 0) {
+        return PIPELINE_CONTINUE;
+    }
+    
+    buffer.events[0] = *event;
+    buffer.count = 1;
+    buffer.mask = bit;
+    buffer.start_us = event->time_us;
+    buffer.deadline_us = event->time_us + term_us;
+    buffer.matched = -1;
+    deadline_schedule(&combo_deadline, buffer.deadline_us);
+    
+    return PIPELINE_DEFERRED;
+}
+
+static pipeline_result_t HOT_PATH(process_combo_release)(key_event_t *event) {
+    uint64_t bit = position_bit(event->row, event->col);
+    
+    // Releasing a key of a fired combo releases its output once
+    for (uint8_t i = 0; i < COMBO_MAX_ACTIVE; i++) {
+        if (!(active[i].held & bit)) continue;
+        
+        if (active[i].output_held) {
+            release_combo(&active[i], event);
+        }
+        active[i].held &= ~bit;
+        return PIPELINE_CONSUMED;
+    }
+    
+    // Any release settles the pending decision first to keep event order
+    if (buffer.count > 0) {
+        resolve_buffer();
+        
+        // The key may have just become part of a fired combo
+        for (uint8_t i = 0; i < COMBO_MAX_ACTIVE; i++) {
+            if (active[i].held & bit) {
+                release_combo(&active[i], event);
+                active[i].held &= ~bit;
+                return PIPELINE_CONSUMED;
             }
         }
+    }
+    
+    return PIPELINE_CONTINUE;
+}
+
+pipeline_result_t HOT_PATH(process_combo)(key_event_t *event) {
+    if (!event->pressed) {
+        return process_combo_release(event);
+    }
+    
+    if (buffer.count == 0) {
+        return start_buffer(event);
+    }
+    
+    // Does the new key keep a combo possible?
+    uint64_t mask = buffer.mask | position_bit(event->row, event->col);
+    int16_t exact;
+    uint32_t term_us;
+    
+    if (buffer.count < COMBO_MAX_KEYS &&
+        timer_before_us(event->time_us, buffer.deadline_us)) {
+        uint8_t open = find_candidates(event->row, event->col, mask, &exact, &term_us);
         
-        if (match) {
-            // Combo matched!
-            register_key(combo->keycode);
-            unregister_key(combo->keycode);
-            combo_state.active = false;
-            combo_state.pressed_count = 0;
-            return false;  // Don't process original keys
+        if (open > 0 || exact >= 0) {
+            buffer.events[buffer.count++] = *event;
+            buffer.mask = mask;
+            buffer.deadline_us = buffer.start_us + term_us;
+            deadline_schedule(&combo_deadline, buffer.deadline_us);
+            if (exact >= 0) {
+                buffer.matched = exact;
+            }
+            
+            // Nothing larger can follow - no reason to wait
+            if (open == 0) {
+                resolve_buffer();
+            }
+            return PIPELINE_DEFERRED;
         }
     }
     
-    return true;
+    // The new key breaks the combo - settle, then treat it as a fresh press
+    resolve_buffer();
+    return start_buffer(event);
 }
 
-void init_combos(void) {
-    // Initialization if needed
-}
\ No newline at end of file
+// The combo window closed - settle whatever is buffered
+static void combo_expired(void *ctx) {
+    (void)ctx;
+    if (buffer.count > 0) {
+        resolve_buffer();
+        send_hid_report();
+    }
+}
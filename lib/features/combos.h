@@ -3,14 +3,37 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "pipeline.h"
+
+#define COMBO_MAX_KEYS 8
+#define COMBO_MAX_ACTIVE 4
+
+// Placements of all combos together - a combo whose keys sit at several
+// positions, or at different positions per layer, takes one per layout
+#define COMBO_MAX_VARIANTS (MAX_COMBOS * 2)
+
+// Key positions as bits, row * KEYMAP_COLS + col
+#define COMBO_POSITIONS (MATRIX_ROWS * KEYMAP_COLS)
+_Static_assert(COMBO_POSITIONS <= 64, "Combo position mask is 64 bits");
 
 typedef struct {
     const uint16_t *keys;
     uint8_t key_count;
     uint16_t keycode;
+    uint16_t term;    // Milliseconds, 0 = COMBO_TERM
+    uint32_t layers;  // Layers the combo is active on, 0 = all
 } combo_t;
 
+typedef struct {
+    uint16_t variants;  // Position sets the combos resolved to
+    uint16_t dropped;   // Combos left out or incomplete: no room for their variants
+} combo_stats_t;
+
+// Keys are given as keycodes. On each layer the combo is active on, every
+// set of positions carrying them there triggers it.
 void init_combos(void);
-bool process_combo(uint16_t keycode, bool pressed);
+void combos_set_stage(uint8_t stage);
+pipeline_result_t process_combo(key_event_t *event);
+const combo_stats_t *get_combo_stats(void);
 
 #endif // COMBOS_H
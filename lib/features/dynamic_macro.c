@@ -0,0 +1,156 @@
+#include "dynamic_macro.h"
+#include "config.h"
+#include "keycodes.h"
+#include "macro.h"
+#include "hot_path.h"
+#include <string.h>
+
+#define NOT_RECORDING 0xFF
+
+static uint8_t arena[DYNAMIC_MACRO_SLOTS][DYNAMIC_MACRO_SLOT_SIZE];
+static dynamic_macro_info_t info[DYNAMIC_MACRO_SLOTS];
+
+static struct {
+    uint8_t slot;            // Slot being recorded, NOT_RECORDING if none
+    uint16_t length;         // Bytes written so far
+    uint16_t clean_length;   // Length when no recorded key was last held
+    uint8_t keys_down;
+    uint32_t down[8];        // Keycodes whose press was recorded
+    uint32_t last_us;        // Time of the last recorded event
+} recorder = { .slot = NOT_RECORDING };
+
+void dynamic_macro_init(void) {
+    recorder.slot = NOT_RECORDING;
+    
+    for (uint8_t i = 0; i < DYNAMIC_MACRO_SLOTS; i++) {
+        arena[i][0] = MACRO_OP_END;
+        info[i].used = 0;
+        info[i].size = DYNAMIC_MACRO_SLOT_SIZE - 1;  // Room for MACRO_OP_END
+        info[i].truncated = false;
+    }
+}
+
+static void start_recording(uint8_t slot, uint32_t now_us) {
+    // The slot may be queued for playback
+    macro_stop();
+    
+    recorder.slot = slot;
+    recorder.length = 0;
+    recorder.clean_length = 0;
+    recorder.keys_down = 0;
+    recorder.last_us = now_us;
+    memset(recorder.down, 0, sizeof(recorder.down));
+    
+    arena[slot][0] = MACRO_OP_END;
+    info[slot].used = 0;
+    info[slot].truncated = false;
+}
+
+// Keep only what was recorded up to the last moment no recorded key was
+// held, so playback never leaves a key down
+static void finish_recording(void) {
+    uint8_t slot = recorder.slot;
+    if (slot == NOT_RECORDING) return;
+    
+    arena[slot][recorder.clean_length] = MACRO_OP_END;
+    info[slot].used = recorder.clean_length;
+    recorder.slot = NOT_RECORDING;
+}
+
+static void HOT_PATH(record_event)(const key_event_t *event) {
+    uint8_t keycode = event->keycode & 0xFF;
+    uint32_t bit = 1u << (keycode & 31);
+    uint32_t *down = &recorder.down[keycode >> 5];
+    
+    if (event->keycode == KC_NO || event->keycode == KC_TRNS) return;
+    
+    // Releases of keys held before the recording started are left out
+    if (!event->pressed && !(*down & bit)) return;
+    if (event->pressed && (*down & bit)) return;
+    
+    uint8_t *slot = arena[recorder.slot];
+    uint16_t needed = 2;
+    uint16_t delay_ms = 0;
+
+#if DYNAMIC_MACRO_TIMING
+    uint32_t gap_ms = (event->time_us - recorder.last_us) / 1000;
+    delay_ms = gap_ms > 0xFFFF ? 0xFFFF : gap_ms;
+    if (delay_ms > 0) needed += 3;
+#endif
+    recorder.last_us = event->time_us;
+    
+    if (recorder.length + needed > info[recorder.slot].size) {
+        info[recorder.slot].truncated = true;
+        finish_recording();
+        return;
+    }
+    
+    if (delay_ms > 0) {
+        slot[recorder.length++] = MACRO_OP_DELAY;
+        slot[recorder.length++] = delay_ms & 0xFF;
+        slot[recorder.length++] = delay_ms >> 8;
+    }
+    
+    slot[recorder.length++] = event->pressed ? MACRO_OP_DOWN : MACRO_OP_UP;
+    slot[recorder.length++] = keycode;
+    
+    if (event->pressed) {
+        *down |= bit;
+        recorder.keys_down++;
+    } else {
+        *down &= ~bit;
+        recorder.keys_down--;
+    }
+    
+    if (recorder.keys_down == 0) {
+        recorder.clean_length = recorder.length;
+    }
+}
+
+pipeline_result_t HOT_PATH(process_dynamic_macro)(key_event_t *event) {
+    uint16_t keycode = event->keycode;
+    
+    switch (keycode) {
+        case DM_REC1:
+        case DM_REC2:
+            if (event->pressed) {
+                uint8_t slot = keycode - DM_REC1;
+                if (recorder.slot == NOT_RECORDING) {
+                    start_recording(slot, event->time_us);
+                } else {
+                    finish_recording();
+                }
+            }
+            return PIPELINE_CONSUMED;
+        
+        case DM_RSTP:
+            if (event->pressed) {
+                finish_recording();
+            }
+            return PIPELINE_CONSUMED;
+        
+        case DM_PLY1:
+        case DM_PLY2:
+            if (event->pressed) {
+                uint8_t slot = keycode - DM_PLY1;
+                if (slot != recorder.slot && info[slot].used > 0) {
+                    macro_play(arena[slot]);
+                }
+            }
+            return PIPELINE_CONSUMED;
+    }
+    
+    if (recorder.slot != NOT_RECORDING && keycode_class(keycode) == KC_CLASS_BASIC) {
+        record_event(event);
+    }
+    
+    return PIPELINE_CONTINUE;
+}
+
+bool dynamic_macro_is_recording(void) {
+    return recorder.slot != NOT_RECORDING;
+}
+
+const dynamic_macro_info_t *get_dynamic_macro_info(uint8_t slot) {
+    return slot < DYNAMIC_MACRO_SLOTS ? &info[slot] : NULL;
+}
@@ -0,0 +1,28 @@
+#ifndef DYNAMIC_MACRO_H
+#define DYNAMIC_MACRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pipeline.h"
+
+// Keys recorded on the fly into a RAM arena and replayed through the
+// macro sequencer. Each slot gets an equal share of the arena.
+#define DYNAMIC_MACRO_SLOT_SIZE (DYNAMIC_MACRO_SIZE / DYNAMIC_MACRO_SLOTS)
+_Static_assert(DYNAMIC_MACRO_SLOTS == 2, "DM_REC1/DM_REC2 and DM_PLY1/DM_PLY2 address two slots");
+_Static_assert(DYNAMIC_MACRO_SLOT_SIZE <= 0xFFFF, "Slot lengths are 16 bits");
+
+typedef struct {
+    uint16_t used;   // Bytes recorded
+    uint16_t size;   // Bytes available to the slot
+    bool truncated;  // The last recording ran out of room
+} dynamic_macro_info_t;
+
+void dynamic_macro_init(void);
+
+// Handles DM_* keycodes and records basic keys while a recording is running
+pipeline_result_t process_dynamic_macro(key_event_t *event);
+
+bool dynamic_macro_is_recording(void);
+const dynamic_macro_info_t *get_dynamic_macro_info(uint8_t slot);
+
+#endif // DYNAMIC_MACRO_H
@@ -0,0 +1,17 @@
+#include "keycode_class.h"
+#include "hot_path.h"
+
+// Keycode class by high byte - every entry not listed is KC_CLASS_UNKNOWN
+const uint8_t keycode_class_table[256] HOT_DATA(keycode_class_table) = {
+    [0x00]          = KC_CLASS_BASIC,
+    [0x51 ... 0x54] = KC_CLASS_LAYER,        // MO, TG, TO, TT
+    [0x55]          = KC_CLASS_ONESHOT,      // OSL
+    [0x56]          = KC_CLASS_TAPDANCE,     // TD
+    [0x57]          = KC_CLASS_ONESHOT,      // OSM
+    [0x5C]          = KC_CLASS_SYSTEM,       // RESET
+    [0x70]          = KC_CLASS_CUSTOM,
+    [0x71]          = KC_CLASS_MOUSE,
+    [0x72]          = KC_CLASS_AUTOCLICKER,
+    [0x73]          = KC_CLASS_MACRO,
+    [0xE0 ... 0xE7] = KC_CLASS_MODTAP,       // MT(KC_LCTL..KC_RGUI, kc)
+};
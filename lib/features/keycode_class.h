@@ -0,0 +1,30 @@
+#ifndef KEYCODE_CLASS_H
+#define KEYCODE_CLASS_H
+
+#include <stdint.h>
+#include "keycodes.h"
+
+// Keycode classes, selected by the keycode's high byte
+typedef enum {
+    KC_CLASS_UNKNOWN = 0,  // Unassigned high byte
+    KC_CLASS_BASIC,        // 0x00xx - HID usages
+    KC_CLASS_LAYER,        // MO/TG/TO/TT
+    KC_CLASS_ONESHOT,      // OSL/OSM
+    KC_CLASS_TAPDANCE,     // TD
+    KC_CLASS_SYSTEM,       // RESET
+    KC_CLASS_CUSTOM,       // 0x70xx - keymap custom keycodes
+    KC_CLASS_MOUSE,        // 0x71xx
+    KC_CLASS_AUTOCLICKER,  // 0x72xx
+    KC_CLASS_MACRO,        // 0x73xx
+    KC_CLASS_MODTAP,       // MT(mod, kc)
+    KC_CLASS_COUNT
+} keycode_class_t;
+
+extern const uint8_t keycode_class_table[256];
+
+// Single table load instead of a cascade of range checks
+static inline keycode_class_t keycode_class(uint16_t keycode) {
+    return (keycode_class_t)keycode_class_table[keycode >> 8];
+}
+
+#endif // KEYCODE_CLASS_H
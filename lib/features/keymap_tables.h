@@ -0,0 +1,22 @@
+#ifndef KEYMAP_TABLES_H
+#define KEYMAP_TABLES_H
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tables derived from the keymap at compile time by the keymap's
+// keymap_tables.cpp, kept in flash
+typedef struct {
+    layer_state_t layers[MATRIX_ROWS][KEYMAP_COLS];  // Layers with a non-transparent key in each cell
+} keymap_defined_t;
+
+extern const keymap_defined_t keymap_defined_layers;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KEYMAP_TABLES_H
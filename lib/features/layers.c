@@ -1,75 +1,181 @@
 #include "layers.h"
 #include "timer.h"
+#include "tap_hold.h"
+#include "keymap_tables.h"
+#include "hot_path.h"
 
-static uint8_t layer_state = 1;  // Bitmask, layer 0 always active
-static struct {
-    uint32_t timer;
-    uint8_t count;
-    uint8_t layer;
-} tap_toggle_state = {0};
+#define LAYER_BIT(layer) ((layer_state_t)1 << (layer))
+
+static layer_state_t layer_state = 0;          // Momentary/toggled layers
+static layer_state_t default_layer_state = 1;  // Base layers, layer 0 by default
+static layer_state_t tap_toggle_kept = 0;      // TT layers already on when their hold began
+
+// Keymap resolved for the active layers, with the layer each cell came
+// from. Kept in RAM and updated only when a layer changes, so a lookup
+// is a single load instead of a flash walk through KC_TRNS.
+static uint16_t resolved_keymap[MATRIX_ROWS][KEYMAP_COLS];
+static uint8_t resolved_source[MATRIX_ROWS][KEYMAP_COLS];
+
+static inline layer_state_t active_layers(void) {
+    return layer_state | default_layer_state;
+}
+
+// Highest set bit, constant time regardless of the layer count
+static inline uint8_t highest_layer(layer_state_t state) {
+    return state ? 31 - __builtin_clz(state) : 0;
+}
+
+// Keymap entry, treating layers beyond the keymap as fully transparent
+static uint16_t HOT_PATH(keymap_key)(uint8_t layer, uint8_t row, uint8_t col) {
+    if (layer >= keymap_layer_count) return KC_TRNS;
+    return keymaps[layer][row][col];
+}
+
+// First non-transparent key among the active layers in `candidates`.
+// The compile-time table of layers defining each cell skips the
+// transparent ones, so this is a single lookup.
+static uint16_t HOT_PATH(walk_layers)(layer_state_t candidates, uint8_t row, uint8_t col, uint8_t *source) {
+    candidates &= keymap_defined_layers.layers[row][col];
+    
+    if (candidates == 0) {
+        *source = 0;
+        return KC_TRNS;
+    }
+    
+    *source = highest_layer(candidates);
+    return keymap_key(*source, row, col);
+}
+
+// Active layers at or below `top`
+static inline layer_state_t layers_up_to(uint8_t top) {
+    layer_state_t below = (top >= 31) ? ~(layer_state_t)0 : LAYER_BIT(top + 1) - 1;
+    return active_layers() & below;
+}
+
+static void HOT_PATH(resolve_cell)(uint8_t top, uint8_t row, uint8_t col) {
+    resolved_keymap[row][col] = walk_layers(layers_up_to(top), row, col,
+                                            &resolved_source[row][col]);
+}
+
+static void resolve_all(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < KEYMAP_COLS; col++) {
+            resolve_cell(MAX_LAYERS - 1, row, col);
+        }
+    }
+}
+
+// A newly active layer only claims the cells it defines above their source
+static void HOT_PATH(resolve_layer_on)(uint8_t layer) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < KEYMAP_COLS; col++) {
+            if (resolved_source[row][col] > layer) continue;
+            if (!(keymap_defined_layers.layers[row][col] & LAYER_BIT(layer))) continue;
+            
+            resolved_keymap[row][col] = keymap_key(layer, row, col);
+            resolved_source[row][col] = layer;
+        }
+    }
+}
+
+// Only the cells the layer was supplying need resolving again
+static void HOT_PATH(resolve_layer_off)(uint8_t layer) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < KEYMAP_COLS; col++) {
+            if (resolved_source[row][col] == layer) {
+                resolve_cell(layer, row, col);
+            }
+        }
+    }
+}
+
+// Apply new layer masks, updating the resolved keymap for what changed
+static void HOT_PATH(set_layer_states)(layer_state_t layers, layer_state_t defaults) {
+    layer_state_t before = active_layers();
+    
+    layer_state = layers;
+    default_layer_state = defaults ? defaults : 1;  // Always keep a base layer
+    
+    layer_state_t after = active_layers();
+    layer_state_t changed = before ^ after;
+    
+    if (changed == 0) return;
+    
+    if ((changed & (changed - 1)) == 0) {
+        // A single layer changed - the common MO/TG/OSL case
+        uint8_t layer = highest_layer(changed);
+        if (after & changed) {
+            resolve_layer_on(layer);
+        } else {
+            resolve_layer_off(layer);
+        }
+    } else {
+        resolve_all();
+    }
+}
 
 void layers_init(void) {
-    layer_state = 1;  // Enable layer 0
+    layer_state = 0;
+    default_layer_state = 1;  // Layer 0 is the base layer
+    tap_toggle_kept = 0;
+    resolve_all();
 }
 
-void layer_on(uint8_t layer) {
+void HOT_PATH(layer_on)(uint8_t layer) {
     if (layer < MAX_LAYERS) {
-        layer_state |= (1 << layer);
+        set_layer_states(layer_state | LAYER_BIT(layer), default_layer_state);
     }
 }
 
-void layer_off(uint8_t layer) {
-    if (layer < MAX_LAYERS && layer != 0) {  // Never turn off layer 0
-        layer_state &= ~(1 << layer);
+void HOT_PATH(layer_off)(uint8_t layer) {
+    if (layer < MAX_LAYERS) {
+        set_layer_states(layer_state & ~LAYER_BIT(layer), default_layer_state);
     }
 }
 
 void layer_toggle(uint8_t layer) {
-    if (layer < MAX_LAYERS && layer != 0) {
-        layer_state ^= (1 << layer);
+    if (layer < MAX_LAYERS) {
+        set_layer_states(layer_state ^ LAYER_BIT(layer), default_layer_state);
     }
 }
 
 void layer_clear(void) {
-    layer_state = 1;  // Keep only layer 0
+    set_layer_states(0, default_layer_state);  // Default layers stay
 }
 
-uint8_t get_highest_layer(void) {
-    for (int8_t i = MAX_LAYERS - 1; i >= 0; i--) {
-        if (layer_state & (1 << i)) {
-            return i;
-        }
+void default_layer_set(uint8_t layer) {
+    if (layer < MAX_LAYERS) {
+        set_layer_states(layer_state, LAYER_BIT(layer));
     }
-    return 0;
 }
 
-uint8_t get_layer_state(void) {
+uint8_t get_highest_layer(void) {
+    return highest_layer(active_layers());
+}
+
+layer_state_t get_layer_state(void) {
     return layer_state;
 }
 
-uint16_t get_keycode_at(uint8_t layer, uint8_t row, uint8_t col) {
-    if (layer >= MAX_LAYERS) return KC_NO;
-    
-    // Combine column for split keyboard
-    uint8_t actual_col = col;
-    
-    uint16_t keycode = keymaps[layer][row][actual_col];
-    
-    // Handle transparent keys
-    if (keycode == KC_TRNS && layer > 0) {
-        // Check lower layers
-        for (int8_t i = layer - 1; i >= 0; i--) {
-            if (layer_state & (1 << i)) {
-                keycode = keymaps[i][row][actual_col];
-                if (keycode != KC_TRNS) break;
-            }
-        }
-    }
+layer_state_t get_default_layer_state(void) {
+    return default_layer_state;
+}
+
+uint16_t HOT_PATH(get_keycode_at)(uint8_t layer, uint8_t row, uint8_t col) {
+    if (layer >= MAX_LAYERS || row >= MATRIX_ROWS || col >= KEYMAP_COLS) return KC_NO;
     
-    return keycode;
+    // The requested layer itself, then active layers below it
+    uint8_t source;
+    layer_state_t candidates = layers_up_to(layer) | LAYER_BIT(layer);
+    return walk_layers(candidates, row, col, &source);
+}
+
+uint16_t HOT_PATH(get_resolved_keycode)(uint8_t row, uint8_t col) {
+    if (row >= MATRIX_ROWS || col >= KEYMAP_COLS) return KC_NO;
+    return resolved_keymap[row][col];
 }
 
-bool process_layer_keycode(uint16_t keycode, bool pressed) {
+bool HOT_PATH(process_layer_keycode)(uint16_t keycode, bool pressed) {
     uint16_t type = keycode & 0xFF00;
     uint8_t layer = keycode & 0x00FF;
     
@@ -94,29 +200,40 @@ bool process_layer_keycode(uint16_t keycode, bool pressed) {
                 layer_on(layer);
             }
             return false;
-            
-        case 0x5400:  // TT - Tap Toggle
-            if (pressed) {
-                if (timer_elapsed(tap_toggle_state.timer) < TAPPING_TERM && 
-                    tap_toggle_state.layer == layer) {
-                    tap_toggle_state.count++;
-                    if (tap_toggle_state.count >= 2) {
-                        layer_toggle(layer);
-                        tap_toggle_state.count = 0;
-                    }
-                } else {
-                    tap_toggle_state.count = 1;
-                    tap_toggle_state.layer = layer;
-                    layer_on(layer);
-                }
-                tap_toggle_state.timer = timer_read();
-            } else {
-                if (!(layer_state & (1 << layer))) {
-                    layer_off(layer);
-                }
-            }
-            return false;
     }
     
     return true;
 }
+
+// TT - hold for the layer while held, TAPPING_TOGGLE taps to toggle it
+static void tap_toggle_tap(const key_event_t *event, uint8_t count, bool pressed) {
+    if (pressed && count >= TAPPING_TOGGLE) {
+        layer_toggle(event->keycode & 0x00FF);
+    }
+}
+
+static void tap_toggle_hold(const key_event_t *event, uint8_t count, bool pressed) {
+    (void)count;
+    uint8_t layer = event->keycode & 0x00FF;
+    if (layer >= MAX_LAYERS) return;
+    
+    // Leave a layer that was toggled on by earlier taps alone
+    if (pressed) {
+        if (active_layers() & LAYER_BIT(layer)) {
+            tap_toggle_kept |= LAYER_BIT(layer);
+        } else {
+            layer_on(layer);
+        }
+    } else if (tap_toggle_kept & LAYER_BIT(layer)) {
+        tap_toggle_kept &= ~LAYER_BIT(layer);
+    } else {
+        layer_off(layer);
+    }
+}
+
+const tap_hold_behavior_t tap_toggle_behavior = {
+    .flags = TAP_HOLD_MULTI_TAP | TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS,
+    .term_ms = TAPPING_TERM,
+    .on_tap = tap_toggle_tap,
+    .on_hold = tap_toggle_hold
+};
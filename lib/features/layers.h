@@ -5,18 +5,28 @@
 #include <stdbool.h>
 #include "config.h"
 #include "keycodes.h"
+#include "tap_hold.h"
 
 void layers_init(void);
 void layer_on(uint8_t layer);
 void layer_off(uint8_t layer);
 void layer_toggle(uint8_t layer);
 void layer_clear(void);
+void default_layer_set(uint8_t layer);
 uint8_t get_highest_layer(void);
-uint8_t get_layer_state(void);
+layer_state_t get_layer_state(void);
+layer_state_t get_default_layer_state(void);
 bool process_layer_keycode(uint16_t keycode, bool pressed);
 uint16_t get_keycode_at(uint8_t layer, uint8_t row, uint8_t col);
 
+// TT keys are decided by the tap-hold engine
+extern const tap_hold_behavior_t tap_toggle_behavior;
+
+// Keycode at the current layer state, from the cached resolved keymap
+uint16_t get_resolved_keycode(uint8_t row, uint8_t col);
+
 // Keymap is defined externally
-extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS * 2];
+extern const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS];
+extern const uint8_t keymap_layer_count;
 
 #endif // LAYERS_H
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "macro.h"
+#include "config.h"
+#include "keycodes.h"
+#include "timer.h"
+#include "deadline.h"
+#include "usb_hid.h"
+#include <stddef.h>
+
+extern const uint8_t *const keymap_macros[];
+extern const uint8_t keymap_macro_count;
+
+// Playback runs off a deadline and emits at most one keyboard state per
+// step, and only once the previous state has left the report queue, so
+// the host sees every state however long the macro is
+static struct {
+    const uint8_t *pc;
+    uint8_t tap_release;  // Key to release on the next step, KC_NO if none
+    uint8_t mods_down;    // MOD_* bits pressed by the macro
+    uint32_t keys_down[8];  // Keys pressed by MACRO_OP_DOWN and not yet up, one bit per keycode
+    bool active;
+} player = {0};
+
+static const uint8_t *queue[MACRO_QUEUE_SIZE];
+static uint8_t queue_head = 0;
+static uint8_t queue_count = 0;
+
+static uint32_t step_us = MACRO_STEP_US;
+static macro_stats_t stats = {0};
+
+static void macro_step(void *ctx);
+static deadline_t macro_deadline = DEADLINE_INIT(macro_step, NULL);
+
+void macro_init(void) {
+    macro_stop();
+    step_us = MACRO_STEP_US;
+}
+
+static void start_next(void) {
+    if (queue_count == 0) {
+        player.active = false;
+        return;
+    }
+    
+    player.pc = queue[queue_head];
+    player.tap_release = KC_NO;
+    player.mods_down = 0;
+    player.active = true;
+    queue_head = (queue_head + 1) % MACRO_QUEUE_SIZE;
+    queue_count--;
+    stats.played++;
+    
+    deadline_schedule(&macro_deadline, timer_read_us());
+}
+
+bool macro_play(const uint8_t *bytecode) {
+    if (bytecode == NULL) return false;
+    
+    if (queue_count >= MACRO_QUEUE_SIZE) {
+        stats.dropped++;
+        return false;
+    }
+    
+    queue[(queue_head + queue_count) % MACRO_QUEUE_SIZE] = bytecode;
+    queue_count++;
+    
+    if (!player.active) start_next();
+    return true;
+}
+
+static void set_mods(uint8_t mods, bool pressed) {
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(mods & (1 << i))) continue;
+        if (pressed) {
+            register_modifier(KC_LCTL + i);
+        } else {
+            unregister_modifier(KC_LCTL + i);
+        }
+    }
+}
+
+static void mark_key(uint8_t keycode, bool down) {
+    uint32_t bit = 1u << (keycode & 31);
+    if (down) {
+        player.keys_down[keycode >> 5] |= bit;
+    } else {
+        player.keys_down[keycode >> 5] &= ~bit;
+    }
+}
+
+// Release every key and modifier the macro still holds
+static void release_all(void) {
+    if (player.tap_release != KC_NO) {
+        unregister_key(player.tap_release);
+        player.tap_release = KC_NO;
+    }
+    for (uint8_t word = 0; word < 8; word++) {
+        for (uint32_t bits = player.keys_down[word]; bits; bits &= bits - 1) {
+            unregister_key(word * 32 + __builtin_ctz(bits));
+        }
+        player.keys_down[word] = 0;
+    }
+    set_mods(player.mods_down, false);
+    player.mods_down = 0;
+}
+
+// Stop playback, drop the queue and let go of everything held
+void macro_stop(void) {
+    deadline_cancel(&macro_deadline);
+    queue_count = 0;
+    
+    if (player.active) {
+        release_all();
+        send_hid_report();
+    }
+    player.active = false;
+}
+
+bool macro_is_playing(void) {
+    return player.active;
+}
+
+void macro_set_step_us(uint32_t us) {
+    step_us = us;
+}
+
+// Run opcodes until one changes the keyboard state or waits; returns the
+// delay before the next step
+static uint32_t run_step(void) {
+    if (player.tap_release != KC_NO) {
+        unregister_key(player.tap_release);
+        player.tap_release = KC_NO;
+        return step_us;
+    }
+    
+    while (true) {
+        uint8_t op = *player.pc++;
+        
+        switch (op) {
+            case MACRO_OP_TAP:
+                player.tap_release = *player.pc++;
+                register_key(player.tap_release);
+                return step_us;
+            
+            case MACRO_OP_DOWN:
+                mark_key(*player.pc, true);
+                register_key(*player.pc++);
+                return step_us;
+            
+            case MACRO_OP_UP:
+                mark_key(*player.pc, false);
+                unregister_key(*player.pc++);
+                return step_us;
+            
+            case MACRO_OP_DELAY: {
+                uint16_t ms = player.pc[0] | (player.pc[1] << 8);
+                player.pc += 2;
+                if (ms > 0) return TIMER_MS_TO_US(ms);
+                break;
+            }
+            
+            case MACRO_OP_MODS_DOWN:
+                player.mods_down |= *player.pc;
+                set_mods(*player.pc++, true);
+                return step_us;
+            
+            case MACRO_OP_MODS_UP:
+                player.mods_down &= ~*player.pc;
+                set_mods(*player.pc++, false);
+                return step_us;
+            
+            default:  // MACRO_OP_END, or bytecode we do not understand
+                release_all();
+                player.active = false;
+                return 0;
+        }
+    }
+}
+
+static void macro_step(void *ctx) {
+    (void)ctx;
+    if (!player.active) return;
+    
+    uint32_t now = timer_read_us();
+    
+    // The host has not taken the last state yet
+    if (!hid_report_queue_empty()) {
+        stats.waits++;
+        deadline_schedule(&macro_deadline, now + step_us);
+        return;
+    }
+    
+    uint32_t delay_us = run_step();
+    
+    if (player.active) {
+        stats.steps++;
+        send_hid_report();
+        deadline_schedule(&macro_deadline, now + delay_us);
+    } else {
+        send_hid_report();
+        start_next();
+    }
+}
+
+bool process_macro_keycode(uint16_t keycode, bool pressed) {
+    if ((keycode & 0xFF00) != MACRO(0)) {
+        return true;  // Not a macro keycode
+    }
+    
+    uint8_t index = keycode & 0x00FF;
+    if (pressed && index < keymap_macro_count) {
+        macro_play(keymap_macros[index]);
+    }
+    return false;
+}
+
+const macro_stats_t *get_macro_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,50 @@
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Macro bytecode - one opcode byte followed by its operands. Keycodes are
+// basic keycodes (one byte), including the modifiers KC_LCTL..KC_RGUI.
+#define MACRO_OP_END       0x00
+#define MACRO_OP_TAP       0x01  // kc - press, then release on the next step
+#define MACRO_OP_DOWN      0x02  // kc
+#define MACRO_OP_UP        0x03  // kc
+#define MACRO_OP_DELAY     0x04  // ms low byte, ms high byte
+#define MACRO_OP_MODS_DOWN 0x05  // MOD_* mask
+#define MACRO_OP_MODS_UP   0x06  // MOD_* mask
+
+#define MACRO_TAP(kc)   MACRO_OP_TAP, (kc)
+#define MACRO_DOWN(kc)  MACRO_OP_DOWN, (kc)
+#define MACRO_UP(kc)    MACRO_OP_UP, (kc)
+#define MACRO_DELAY(ms) MACRO_OP_DELAY, ((ms) & 0xFF), (((ms) >> 8) & 0xFF)
+#define MACRO_WRAP(mods, ...) MACRO_OP_MODS_DOWN, (mods), __VA_ARGS__, MACRO_OP_MODS_UP, (mods)
+
+// e.g. static const uint8_t macro_copy[] = { MACRO_WRAP(MOD_LCTL, MACRO_TAP(KC_C)), MACRO_OP_END };
+
+#define MACRO_QUEUE_SIZE 4  // Macros waiting behind the one playing
+
+typedef struct {
+    uint32_t played;
+    uint32_t steps;    // Sequencer steps run
+    uint32_t waits;    // Steps held back for the report queue to drain
+    uint32_t dropped;  // Macros rejected on a full queue
+} macro_stats_t;
+
+void macro_init(void);
+
+// Queue a macro behind any that are playing; the bytecode must stay valid
+// until it finishes. Returns false if the queue is full.
+bool macro_play(const uint8_t *bytecode);
+void macro_stop(void);
+bool macro_is_playing(void);
+
+// Minimum time between emitted states, MACRO_STEP_US by default
+void macro_set_step_us(uint32_t step_us);
+
+// MACRO(n) keycodes play keymap_macros[n]
+bool process_macro_keycode(uint16_t keycode, bool pressed);
+
+const macro_stats_t *get_macro_stats(void);
+
+#endif // MACRO_H
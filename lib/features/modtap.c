@@ -1,98 +1,51 @@
 #include "modtap.h"
-#include "timer.h"
 #include "usb_hid.h"  // This include
 #include "keycodes.h"
+#include "adaptive_term.h"
+#include "hot_path.h"
 
-typedef enum {
-    MT_IDLE,
-    MT_WAITING,
-    MT_HELD,
-    MT_TAPPED
-} modtap_state_t;
-
-typedef struct {
-    modtap_state_t state;
-    uint32_t press_time;
-    uint16_t keycode;
-    uint8_t row;
-    uint8_t col;
-} modtap_t;
+// Tap sends the key on through the remaining stages
+static void HOT_PATH(modtap_tap)(const key_event_t *event, uint8_t count, bool pressed) {
+    (void)count;
+    tap_hold_emit(event, event->keycode & 0x00FF, pressed);
+}
 
-static modtap_t modtap_keys[MAX_MODTAP_KEYS] = {0};
+// Mod-taps holding each modifier, so releasing one of two keys that
+// share a modifier leaves it applied
+static uint8_t mod_holds[8] = {0};
 
-bool process_modtap(uint16_t keycode, bool pressed, uint8_t row, uint8_t col) {
-    // Check if this is a mod-tap key (has modifier in upper byte)
-    if ((keycode & 0xFF00) < 0xE000 || (keycode & 0xFF00) > 0xE700) {
-        return true;  // Not a mod-tap key
-    }
+// Hold applies the modifier from the upper byte
+static void HOT_PATH(modtap_hold)(const key_event_t *event, uint8_t count, bool pressed) {
+    (void)count;
+    uint8_t mod = (event->keycode & 0xFF00) >> 8;
+    if (mod < KC_LCTL || mod > KC_RGUI) return;
     
-    uint8_t mod = (keycode & 0xFF00) >> 8;
-    uint8_t kc = keycode & 0x00FF;
-    
-    // Find slot for this key
-    modtap_t *mt = NULL;
-    for (int i = 0; i < MAX_MODTAP_KEYS; i++) {
-        if (modtap_keys[i].row == row && modtap_keys[i].col == col) {
-            mt = &modtap_keys[i];
-            break;
-        } else if (modtap_keys[i].state == MT_IDLE && mt == NULL) {
-            mt = &modtap_keys[i];
-        }
-    }
-    
-    if (!mt) return false;  // No slot available
+    uint8_t *holds = &mod_holds[mod - KC_LCTL];
     
     if (pressed) {
-        mt->state = MT_WAITING;
-        mt->press_time = timer_read();
-        mt->keycode = keycode;
-        mt->row = row;
-        mt->col = col;
-    } else {
-        uint32_t hold_time = timer_elapsed(mt->press_time);
-        
-        if (mt->state == MT_WAITING && hold_time < TAPPING_TERM) {
-            // It was a tap
-            register_key(kc);
-            unregister_key(kc);
-            mt->state = MT_TAPPED;
-        } else if (mt->state == MT_HELD) {
-            // Release the modifier
-            unregister_modifier(mod);
-        }
-        
-        mt->state = MT_IDLE;
+        if ((*holds)++ == 0) register_modifier(mod);
+    } else if (*holds > 0) {
+        if (--(*holds) == 0) unregister_modifier(mod);
     }
-    
-    return false;
 }
 
-void modtap_task(void) {
-    for (int i = 0; i < MAX_MODTAP_KEYS; i++) {
-        modtap_t *mt = &modtap_keys[i];
-        
-        if (mt->state == MT_WAITING) {
-            uint32_t hold_time = timer_elapsed(mt->press_time);
-            
-            if (hold_time >= TAPPING_TERM) {
-                // Convert to hold
-                mt->state = MT_HELD;
-                uint8_t mod = (mt->keycode & 0xFF00) >> 8;
-                register_modifier(mod);
-            }
-        }
+// Only the mod-taps the keymap lists tap mid typing streak, so a chord
+// like Ctrl+A typed quickly on any other mod-tap stays a hold
+static uint8_t HOT_PATH(modtap_flags)(const key_event_t *event) {
+    for (const uint16_t *key = modtap_streak_keys; *key != KC_NO; key++) {
+        if (*key == event->keycode) return MODTAP_STRATEGY | TAP_HOLD_STREAK;
     }
+    return MODTAP_STRATEGY;
 }
 
-void modtap_interrupt(void) {
-    // Called when another key is pressed (permissive hold)
-    for (int i = 0; i < MAX_MODTAP_KEYS; i++) {
-        modtap_t *mt = &modtap_keys[i];
-        
-        if (mt->state == MT_WAITING) {
-            mt->state = MT_HELD;
-            uint8_t mod = (mt->keycode & 0xFF00) >> 8;
-            register_modifier(mod);
-        }
-    }
-}
+const tap_hold_behavior_t modtap_behavior = {
+    .flags = MODTAP_STRATEGY,
+    .get_flags = modtap_flags,
+    .term_ms = TAPPING_TERM,
+#if ADAPTIVE_TERM_ENABLE
+    .get_term = adaptive_term_get,
+    .on_release = adaptive_term_observe,
+#endif
+    .on_tap = modtap_tap,
+    .on_hold = modtap_hold
+};
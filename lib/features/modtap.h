@@ -4,9 +4,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "config.h"
+#include "tap_hold.h"
 
-bool process_modtap(uint16_t keycode, bool pressed, uint8_t row, uint8_t col);
-void modtap_task(void);
-void modtap_interrupt(void);
+// Mod-tap keys are decided by the tap-hold engine
+extern const tap_hold_behavior_t modtap_behavior;
+
+// Mod-taps that tap at once when pressed mid typing streak, ending in
+// KC_NO. Defined by the keymap; leave it empty for none.
+extern const uint16_t modtap_streak_keys[];
 
 #endif // MODTAP_H
@@ -1,7 +1,9 @@
 #include "mouse.h"
 #include "keycodes.h"
 #include "timer.h"
+#include "deadline.h"
 #include "tusb.h"
+#include "usb_hid.h"
 #include <string.h>
 
 static mouse_state_t mouse_state = {
@@ -17,13 +19,15 @@ static autoclicker_state_t autoclicker = {
     .active = false,
     .button = MOUSE_BTN1,
     .interval_ms = AC_INTERVAL_DEFAULT,
-    .last_click_time = 0,
     .click_state = false
 };
 
+static void autoclicker_step(void *ctx);
+static deadline_t autoclicker_deadline = DEADLINE_INIT(autoclicker_step, NULL);
+
 static bool mouse_report_dirty = false;
 
-// Mouse Report structure (matches TinyUSB HID_REPORT_ID(2))
+// Mouse Report structure (matches TUD_HID_REPORT_DESC_MOUSE on the mouse interface)
 typedef struct {
     uint8_t buttons;
     int8_t x;
@@ -79,7 +83,7 @@ void mouse_release_button(uint8_t button) {
 void mouse_click_button(uint8_t button) {
     mouse_press_button(button);
     mouse_send_report();
-    sleep_ms(5);
+    wait_ms(5);
     mouse_release_button(button);
     mouse_send_report();
 }
@@ -94,9 +98,9 @@ uint8_t mouse_get_speed(void) {
     return mouse_state.speed_multiplier;
 }
 
-// Send mouse HID report
+// Send mouse HID report on the mouse interface
 void mouse_send_report(void) {
-    if (!tud_hid_ready()) return;
+    if (!tud_hid_n_ready(HID_ITF_MOUSE)) return;
     
     // Prepare report
     mouse_report.buttons = mouse_state.buttons;
@@ -105,8 +109,10 @@ void mouse_send_report(void) {
     mouse_report.wheel = mouse_state.wheel_v;
     mouse_report.pan = mouse_state.wheel_h;
     
-    // Send report with report ID 2
-    tud_hid_report(2, &mouse_report, sizeof(mouse_report));
+    // Keep the pending movement for the next attempt if the report was rejected
+    if (!tud_hid_n_report(HID_ITF_MOUSE, 0, &mouse_report, sizeof(mouse_report))) {
+        return;
+    }
     
     // Clear movement and wheel after sending
     mouse_state.x = 0;
@@ -139,8 +145,8 @@ void autoclicker_init(void) {
     autoclicker.active = false;
     autoclicker.button = MOUSE_BTN1;
     autoclicker.interval_ms = AC_INTERVAL_DEFAULT;
-    autoclicker.last_click_time = 0;
     autoclicker.click_state = false;
+    deadline_cancel(&autoclicker_deadline);
 }
 
 // Toggle auto-clicker
@@ -156,13 +162,14 @@ void autoclicker_toggle(void) {
 void autoclicker_start(uint8_t button) {
     autoclicker.active = true;
     autoclicker.button = button;
-    autoclicker.last_click_time = timer_read();
     autoclicker.click_state = false;
+    deadline_schedule(&autoclicker_deadline, timer_read_us() + autoclicker.interval_ms * 500);
 }
 
 // Stop auto-clicker
 void autoclicker_stop(void) {
     autoclicker.active = false;
+    deadline_cancel(&autoclicker_deadline);
     // Release button if currently pressed
     if (autoclicker.click_state) {
         mouse_release_button(autoclicker.button);
@@ -198,29 +205,27 @@ uint32_t autoclicker_get_interval(void) {
     return autoclicker.interval_ms;
 }
 
-// Auto-clicker task - called periodically
-void autoclicker_task(void) {
+// Auto-clicker step - half interval for press, half for release
+static void autoclicker_step(void *ctx) {
+    (void)ctx;
     if (!autoclicker.active) return;
     
-    uint32_t now = timer_read();
-    uint32_t elapsed = now - autoclicker.last_click_time;
-    
-    // Half interval for press, half for release
-    uint32_t half_interval = autoclicker.interval_ms / 2;
-    
-    if (!autoclicker.click_state && elapsed >= half_interval) {
-        // Press button
+    if (!autoclicker.click_state) {
         mouse_press_button(autoclicker.button);
-        mouse_send_report();
-        autoclicker.click_state = true;
-        autoclicker.last_click_time = now;
-    } else if (autoclicker.click_state && elapsed >= half_interval) {
-        // Release button
+    } else {
         mouse_release_button(autoclicker.button);
-        mouse_send_report();
-        autoclicker.click_state = false;
-        autoclicker.last_click_time = now;
     }
+    mouse_send_report();
+    autoclicker.click_state = !autoclicker.click_state;
+    
+    // Step from the scheduled time so the rate does not drift, but never
+    // try to catch up on clicks missed while the loop was busy
+    uint32_t half_interval_us = autoclicker.interval_ms * 500;
+    uint32_t next = autoclicker_deadline.when_us + half_interval_us;
+    if (timer_expired_us(next)) {
+        next = timer_read_us() + half_interval_us;
+    }
+    deadline_schedule(&autoclicker_deadline, next);
 }
 
 // Process mouse keycodes
@@ -2,55 +2,140 @@
 #include "layers.h"
 #include "timer.h"
 #include "config.h"
+#include "deadline.h"
+#include "pipeline.h"
+#include "usb_hid.h"
+#include "hot_path.h"
+#include <stddef.h>
 
+// Modifiers and layers applied by one-shot keys
 typedef struct {
-    bool active;
-    uint8_t layer;
-    uint32_t timer;
-    bool used;
-} oneshot_state_t;
+    uint8_t mods;
+    layer_state_t layers;
+} oneshot_set_t;
 
-static oneshot_state_t oneshot = {0};
+// A one-shot key tapped on its own is armed until the next key is
+// released. Held while another key is pressed, it acts as a normal
+// modifier or momentary layer instead.
+static oneshot_set_t held = {0};       // One-shot keys down
+static oneshot_set_t used = {0};       // Held one-shot keys another key was pressed under
+static oneshot_set_t armed = {0};      // Tapped, waiting for the next key
+static oneshot_set_t consumed = {0};   // Applied to the key currently down
 
-bool process_oneshot_layer(uint16_t keycode, bool pressed) {
-    if ((keycode & 0xFF00) == 0x5500) {  // OSL keycode
-        uint8_t layer = keycode & 0x00FF;
-        
-        if (pressed) {
-            oneshot.active = true;
-            oneshot.layer = layer;
-            oneshot.timer = timer_read();
-            oneshot.used = false;
-            layer_on(layer);
-        }
-        return false;
+static bool consumer_down = false;
+static uint8_t consumer_row;
+static uint8_t consumer_col;
+
+static void oneshot_expired(void *ctx);
+static deadline_t oneshot_deadline = DEADLINE_INIT(oneshot_expired, NULL);
+
+static oneshot_set_t HOT_PATH(oneshot_key_set)(uint16_t keycode) {
+    oneshot_set_t set = {0};
+    
+    if ((keycode & 0xFF00) == OSM(0)) {
+        set.mods = keycode & 0x00FF;
+    } else if ((keycode & 0x00FF) < MAX_LAYERS) {
+        set.layers = (layer_state_t)1 << (keycode & 0x00FF);
+    }
+    return set;
+}
+
+static void HOT_PATH(apply)(oneshot_set_t set) {
+    for (uint8_t i = 0; i < 8; i++) {
+        if (set.mods & (1 << i)) register_modifier(KC_LCTL + i);
     }
+    for (layer_state_t layers = set.layers; layers; layers &= layers - 1) {
+        layer_on(__builtin_ctz(layers));
+    }
+}
+
+// Remove what no other one-shot key still needs
+static void HOT_PATH(remove_unused)(oneshot_set_t set) {
+    uint8_t mods = set.mods & ~(held.mods | armed.mods | consumed.mods);
+    layer_state_t layers = set.layers & ~(held.layers | armed.layers | consumed.layers);
     
-    // Check if we should deactivate oneshot
-    if (oneshot.active && pressed && keycode != KC_NO) {
-        if (!oneshot.used) {
-            oneshot.used = true;
-        } else {
-            // Second key pressed, deactivate
-            layer_off(oneshot.layer);
-            oneshot.active = false;
-        }
+    for (uint8_t i = 0; i < 8; i++) {
+        if (mods & (1 << i)) unregister_modifier(KC_LCTL + i);
     }
+    for (; layers; layers &= layers - 1) {
+        layer_off(__builtin_ctz(layers));
+    }
+}
+
+static void HOT_PATH(process_oneshot_key)(uint16_t keycode, bool pressed) {
+    oneshot_set_t set = oneshot_key_set(keycode);
     
-    return true;
+    if (pressed) {
+        held.mods |= set.mods;
+        held.layers |= set.layers;
+        used.mods &= ~set.mods;
+        used.layers &= ~set.layers;
+        apply(set);
+        return;
+    }
+    
+    held.mods &= ~set.mods;
+    held.layers &= ~set.layers;
+    
+    if ((used.mods & set.mods) || (used.layers & set.layers)) {
+        // Held through another key - released like a normal modifier
+        remove_unused(set);
+        return;
+    }
+    
+    // Tapped - stacks with any other armed one-shot keys
+    armed.mods |= set.mods;
+    armed.layers |= set.layers;
+    deadline_schedule(&oneshot_deadline, timer_read_us() + TIMER_MS_TO_US(ONESHOT_TIMEOUT));
 }
 
-void oneshot_task(void) {
-    if (oneshot.active && timer_elapsed(oneshot.timer) > ONESHOT_TIMEOUT) {
-        layer_off(oneshot.layer);
-        oneshot.active = false;
+pipeline_result_t HOT_PATH(process_oneshot)(key_event_t *event) {
+    if (keycode_class(event->keycode) == KC_CLASS_ONESHOT) {
+        process_oneshot_key(event->keycode, event->pressed);
+        return PIPELINE_CONSUMED;
+    }
+    
+    if (event->pressed) {
+        used.mods |= held.mods;
+        used.layers |= held.layers;
+        
+        // The first key after a tap takes the armed one-shots with it
+        if (!consumer_down && (armed.mods || armed.layers) && event->keycode != KC_NO) {
+            consumed = armed;
+            armed = (oneshot_set_t){0};
+            consumer_down = true;
+            consumer_row = event->row;
+            consumer_col = event->col;
+            deadline_cancel(&oneshot_deadline);
+        }
+    } else if (consumer_down && event->row == consumer_row && event->col == consumer_col) {
+        oneshot_set_t done = consumed;
+        consumed = (oneshot_set_t){0};
+        consumer_down = false;
+        remove_unused(done);
     }
+    
+    return PIPELINE_CONTINUE;
+}
+
+// Nothing used the armed one-shots in time
+static void oneshot_expired(void *ctx) {
+    (void)ctx;
+    oneshot_set_t expired = armed;
+    armed = (oneshot_set_t){0};
+    remove_unused(expired);
+    send_hid_report();
 }
 
 uint8_t get_oneshot_layer(void) {
-    return oneshot.active ? oneshot.layer : 0;
+    layer_state_t layers = armed.layers | consumed.layers;
+    return layers ? 31 - __builtin_clz(layers) : 0;
+}
+
+uint8_t get_oneshot_mods(void) {
+    return armed.mods | consumed.mods;
 }
 
 bool is_oneshot_active(void) {
-    return oneshot.active;
+    return armed.mods || armed.layers || consumed.mods || consumed.layers;
 }
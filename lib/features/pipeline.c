@@ -0,0 +1,170 @@
+#include <string.h>
+#include "pipeline.h"
+#include "layers.h"
+#include "timer.h"
+#include "hot_path.h"
+
+// XIP cache counters, cleared before and read after each event. They
+// count cached flash accesses from both cores.
+#ifdef TIMER_VIRTUAL
+static inline void xip_counters_clear(void) {
+}
+
+static inline uint32_t xip_accesses(void) {
+    return 0;
+}
+
+static inline uint32_t xip_hits(void) {
+    return 0;
+}
+#else
+#include "hardware/structs/xip_ctrl.h"
+
+static inline void xip_counters_clear(void) {
+    xip_ctrl_hw->ctr_hit = 0;
+    xip_ctrl_hw->ctr_acc = 0;
+}
+
+static inline uint32_t xip_accesses(void) {
+    return xip_ctrl_hw->ctr_acc;
+}
+
+static inline uint32_t xip_hits(void) {
+    return xip_ctrl_hw->ctr_hit;
+}
+#endif
+
+static pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+static uint8_t stage_count = 0;
+static pipeline_event_stats_t event_stats;
+
+// Keycode each held key resolved to when pressed, so the release reaches
+// the same handlers even if the layer state changed in between
+static uint16_t pressed_keycodes[MATRIX_ROWS][KEYMAP_COLS];
+
+void pipeline_init(void) {
+    memset(stages, 0, sizeof(stages));
+    memset(pressed_keycodes, 0, sizeof(pressed_keycodes));
+    memset(&event_stats, 0, sizeof(event_stats));
+    stage_count = 0;
+    timer_cycles_init();
+}
+
+uint8_t pipeline_register(const char *name, pipeline_stage_fn_t process, uint32_t class_mask) {
+    if (stage_count >= PIPELINE_MAX_STAGES) return PIPELINE_NO_STAGE;
+    
+    pipeline_stage_t *stage = &stages[stage_count];
+    stage->name = name;
+    stage->process = process;
+    stage->class_mask = class_mask;
+    
+    return stage_count++;
+}
+
+uint16_t HOT_PATH(pipeline_resolve_keycode)(uint8_t row, uint8_t col) {
+    return get_resolved_keycode(row, col);
+}
+
+void HOT_PATH(pipeline_refresh_keycode)(key_event_t *event) {
+    if (event->remapped) return;
+    
+    uint16_t *stored = &pressed_keycodes[event->row][event->col];
+    
+    if (event->pressed) {
+        event->keycode = pipeline_resolve_keycode(event->row, event->col);
+        *stored = event->keycode;
+    } else if (*stored != KC_NO) {
+        // Pair the release with its replayed press
+        event->keycode = *stored;
+        *stored = KC_NO;
+    }
+}
+
+void HOT_PATH(pipeline_emit)(key_event_t *event, uint8_t stage) {
+    uint8_t first = (stage == PIPELINE_NO_STAGE) ? 0 : stage + 1;
+    uint32_t class_bit = PIPELINE_CLASS(keycode_class(event->keycode));
+    
+    for (uint8_t i = first; i < stage_count; i++) {
+        pipeline_stage_t *s = &stages[i];
+        if (!(s->class_mask & class_bit)) continue;
+        
+        uint32_t start = timer_read_us();
+        pipeline_result_t result = s->process(event);
+        uint32_t elapsed = timer_elapsed_us(start);
+        
+        s->calls++;
+        s->total_us += elapsed;
+        if (elapsed > s->max_us) {
+            s->max_us = elapsed;
+        }
+        
+        if (result != PIPELINE_CONTINUE) return;
+        
+        // A stage may rewrite the keycode (e.g. a tap resolving to its key)
+        class_bit = PIPELINE_CLASS(keycode_class(event->keycode));
+    }
+}
+
+void HOT_PATH(pipeline_process_key)(uint8_t row, uint8_t col, bool pressed, uint8_t device_id) {
+    if (row >= MATRIX_ROWS || col >= KEYMAP_COLS) return;
+    
+    xip_counters_clear();
+    uint32_t start_cycles = timer_read_cycles();
+    key_event_t event = {
+        .row = row,
+        .col = col,
+        .time_us = timer_read_us(),
+        .device_id = device_id,
+        .pressed = pressed
+    };
+    
+    if (pressed) {
+        event.keycode = pipeline_resolve_keycode(row, col);
+        pressed_keycodes[row][col] = event.keycode;
+    } else {
+        event.keycode = pressed_keycodes[row][col];
+        if (event.keycode == KC_NO) {
+            event.keycode = pipeline_resolve_keycode(row, col);
+        }
+        pressed_keycodes[row][col] = KC_NO;
+    }
+    
+    pipeline_emit(&event, PIPELINE_NO_STAGE);
+    
+    uint32_t cycles = timer_read_cycles() - start_cycles;
+    uint32_t hits = xip_hits();  // Before the access count, which only grows
+    uint32_t accesses = xip_accesses();
+    uint32_t misses = accesses - hits;
+    
+    event_stats.events++;
+    event_stats.cycles_total += cycles;
+    if (cycles > event_stats.cycles_max) {
+        event_stats.cycles_max = cycles;
+    }
+    event_stats.xip_accesses += accesses;
+    event_stats.xip_misses += misses;
+    if (misses > event_stats.xip_misses_max) {
+        event_stats.xip_misses_max = misses;
+    }
+}
+
+uint8_t pipeline_stage_count(void) {
+    return stage_count;
+}
+
+const pipeline_stage_t *pipeline_stage_at(uint8_t index) {
+    return (index < stage_count) ? &stages[index] : NULL;
+}
+
+const pipeline_event_stats_t *get_pipeline_event_stats(void) {
+    return &event_stats;
+}
+
+void pipeline_reset_stats(void) {
+    memset(&event_stats, 0, sizeof(event_stats));
+    for (uint8_t i = 0; i < stage_count; i++) {
+        stages[i].calls = 0;
+        stages[i].total_us = 0;
+        stages[i].max_us = 0;
+    }
+}
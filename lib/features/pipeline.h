@@ -0,0 +1,83 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "keycode_class.h"
+
+// Key event record passed through the processing pipeline
+typedef struct {
+    uint8_t row;
+    uint8_t col;          // Keymap column (device offset already applied)
+    uint16_t keycode;     // Resolved on press, reused for the matching release
+    uint32_t time_us;     // When the event entered the pipeline
+    uint8_t device_id;    // Source device
+    bool pressed;
+    bool remapped;        // Keycode set by a stage rather than the keymap
+} key_event_t;
+
+typedef enum {
+    PIPELINE_CONTINUE,  // Pass the event to the next stage
+    PIPELINE_CONSUMED,  // Event fully handled
+    PIPELINE_DEFERRED   // Stage kept the event and will re-emit it later
+} pipeline_result_t;
+
+typedef pipeline_result_t (*pipeline_stage_fn_t)(key_event_t *event);
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_NO_STAGE   0xFF
+
+// Keycode classes a stage wants to see
+#define PIPELINE_CLASS(c)   (1u << (c))
+#define PIPELINE_ALL_KEYS   0xFFFFFFFFu
+
+typedef struct {
+    const char *name;
+    pipeline_stage_fn_t process;
+    uint32_t class_mask;
+    
+    // Per-stage timing
+    uint32_t calls;
+    uint32_t total_us;
+    uint32_t max_us;
+} pipeline_stage_t;
+
+// Whole-pipeline cost of each matrix event, in CPU cycles so lean builds
+// can be compared below the microsecond timer's resolution, and in XIP
+// cache traffic so flash stalls show up
+typedef struct {
+    uint32_t events;
+    uint64_t cycles_total;
+    uint32_t cycles_max;
+    uint64_t xip_accesses;
+    uint64_t xip_misses;
+    uint32_t xip_misses_max;
+} pipeline_event_stats_t;
+
+void pipeline_init(void);
+
+// Register a stage - stages run in registration order. Returns the stage
+// ID used to re-emit deferred events, or PIPELINE_NO_STAGE when full.
+uint8_t pipeline_register(const char *name, pipeline_stage_fn_t process, uint32_t class_mask);
+
+// Build an event for a matrix transition and run it through every stage
+void pipeline_process_key(uint8_t row, uint8_t col, bool pressed, uint8_t device_id);
+
+// Run an event through the stages after `stage` (PIPELINE_NO_STAGE = all)
+void pipeline_emit(key_event_t *event, uint8_t stage);
+
+// Keycode for a position at the current layer state
+uint16_t pipeline_resolve_keycode(uint8_t row, uint8_t col);
+
+// Resolve a deferred event's keycode again before it is replayed, in case
+// the layer state changed while it was held back
+void pipeline_refresh_keycode(key_event_t *event);
+
+// Statistics access
+uint8_t pipeline_stage_count(void);
+const pipeline_stage_t *pipeline_stage_at(uint8_t index);
+const pipeline_event_stats_t *get_pipeline_event_stats(void);
+void pipeline_reset_stats(void);
+
+#endif // PIPELINE_H
@@ -0,0 +1,277 @@
+#include <string.h>
+#include "tap_hold.h"
+#include "modtap.h"
+#include "layers.h"
+#include "tapdance.h"
+#include "timer.h"
+#include "deadline.h"
+#include "usb_hid.h"
+#include "hot_path.h"
+
+// Key waiting for its tap/hold decision
+typedef struct {
+    const tap_hold_behavior_t *behavior;
+    key_event_t press;
+    uint8_t flags;       // TAP_HOLD_* strategy for this key
+    uint8_t count;
+    bool released;       // Up while waiting for another tap
+    uint32_t deadline_us;
+    bool active;
+} pending_key_t;
+
+// Decided key that is still held down, stored at its key position
+typedef struct {
+    const tap_hold_behavior_t *behavior;
+    key_event_t press;
+    uint8_t flags;
+    uint8_t count;
+    bool hold;
+} held_key_t;
+
+static pending_key_t pending = {0};
+static held_key_t held[TAP_HOLD_POSITIONS];
+static uint64_t held_positions = 0;    // Positions with a decided key down
+static uint64_t held_interrupted = 0;  // Positions with a key pressed since their decision
+
+// Events that arrived while the decision was pending, in order
+static key_event_t buffer[TAP_HOLD_BUFFER_SIZE];
+static uint8_t buffer_count = 0;
+static uint64_t buffered_presses = 0;  // Positions pressed inside the buffer
+
+static uint8_t tap_hold_stage = PIPELINE_NO_STAGE;
+
+// Time of the previous key press, for streak detection
+static uint32_t last_press_us = 0;
+static bool last_press_valid = false;
+
+static void pending_expired(void *ctx);
+static deadline_t pending_deadline = DEADLINE_INIT(pending_expired, NULL);
+
+static inline uint8_t position_index(const key_event_t *event) {
+    return event->row * KEYMAP_COLS + event->col;
+}
+
+static inline uint64_t position_bit(const key_event_t *event) {
+    return 1ull << position_index(event);
+}
+
+static inline bool same_position(const key_event_t *a, const key_event_t *b) {
+    return a->row == b->row && a->col == b->col;
+}
+
+static inline uint32_t term_us(const tap_hold_behavior_t *behavior, const key_event_t *event) {
+    uint16_t term_ms = behavior->get_term ? behavior->get_term(event) : behavior->term_ms;
+    return TIMER_MS_TO_US(term_ms);
+}
+
+static inline uint8_t key_flags(const tap_hold_behavior_t *behavior, const key_event_t *event) {
+    return behavior->get_flags ? behavior->get_flags(event) : behavior->flags;
+}
+
+static const tap_hold_behavior_t *behavior_for(uint16_t keycode) {
+    switch (keycode_class(keycode)) {
+#if MODTAP_ENABLE
+        case KC_CLASS_MODTAP:
+            return &modtap_behavior;
+#endif
+#if TAPDANCE_ENABLE
+        case KC_CLASS_TAPDANCE:
+            return &tap_dance_behavior;
+#endif
+        case KC_CLASS_LAYER:
+            return (keycode & 0xFF00) == TT(0) ? &tap_toggle_behavior : NULL;
+        default:
+            return NULL;
+    }
+}
+
+void tap_hold_init(void) {
+    deadline_cancel(&pending_deadline);
+    memset(&pending, 0, sizeof(pending));
+    held_positions = 0;
+    held_interrupted = 0;
+    buffer_count = 0;
+    buffered_presses = 0;
+    last_press_valid = false;
+}
+
+void tap_hold_set_stage(uint8_t stage) {
+    tap_hold_stage = stage;
+}
+
+void HOT_PATH(tap_hold_emit)(const key_event_t *event, uint16_t keycode, bool pressed) {
+    key_event_t out = *event;
+    out.keycode = keycode;
+    out.pressed = pressed;
+    out.remapped = true;
+    pipeline_emit(&out, tap_hold_stage);
+}
+
+// Feed the buffered events back in order. Keycodes are resolved again
+// since the decision may have changed the layer; a buffered tap-hold key
+// can start a new decision, which buffers whatever follows it.
+static void HOT_PATH(replay_buffer)(void) {
+    key_event_t events[TAP_HOLD_BUFFER_SIZE];
+    uint8_t count = buffer_count;
+    memcpy(events, buffer, sizeof(key_event_t) * count);
+    
+    buffer_count = 0;
+    buffered_presses = 0;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        pipeline_refresh_keycode(&events[i]);
+        if (process_tap_hold(&events[i]) == PIPELINE_CONTINUE) {
+            pipeline_emit(&events[i], tap_hold_stage);
+        }
+    }
+}
+
+static void HOT_PATH(decide)(bool hold) {
+    const tap_hold_behavior_t *behavior = pending.behavior;
+    void (*action)(const key_event_t *, uint8_t, bool) = hold ? behavior->on_hold : behavior->on_tap;
+    
+    pending.active = false;
+    deadline_cancel(&pending_deadline);
+    action(&pending.press, pending.count, true);
+    
+    if (pending.released) {
+        action(&pending.press, pending.count, false);
+    } else {
+        held_key_t *key = &held[position_index(&pending.press)];
+        key->behavior = behavior;
+        key->press = pending.press;
+        key->flags = pending.flags;
+        key->count = pending.count;
+        key->hold = hold;
+        held_positions |= position_bit(&pending.press);
+        held_interrupted &= ~position_bit(&pending.press);
+    }
+    
+    replay_buffer();
+}
+
+static pipeline_result_t HOT_PATH(release_held)(key_event_t *event) {
+    uint64_t bit = position_bit(event);
+    if (!(held_positions & bit)) return PIPELINE_CONTINUE;
+    
+    held_key_t *key = &held[position_index(event)];
+    bool interrupted = held_interrupted & bit;
+    held_positions &= ~bit;
+    
+    if (key->behavior->on_release) {
+        key->behavior->on_release(&key->press, key->hold, event->time_us - key->press.time_us);
+    }
+    
+    if (key->hold) {
+        key->behavior->on_hold(&key->press, key->count, false);
+        
+        // Held on its own past the term - still counts as a tap
+        if ((key->flags & TAP_HOLD_RETRO_TAP) && !interrupted) {
+            key->behavior->on_tap(&key->press, key->count, true);
+            key->behavior->on_tap(&key->press, key->count, false);
+        }
+    } else {
+        key->behavior->on_tap(&key->press, key->count, false);
+    }
+    return PIPELINE_CONSUMED;
+}
+
+static pipeline_result_t HOT_PATH(process_pending)(key_event_t *event) {
+    const tap_hold_behavior_t *behavior = pending.behavior;
+    uint8_t flags = pending.flags;
+    
+    if (same_position(&pending.press, event)) {
+        if (flags & TAP_HOLD_MULTI_TAP) {
+            // Another tap in the sequence, or the end of one
+            if (event->pressed) {
+                pending.count++;
+                pending.released = false;
+            } else {
+                pending.released = true;
+            }
+            pending.deadline_us = event->time_us + term_us(behavior, event);
+            deadline_schedule(&pending_deadline, pending.deadline_us);
+            return PIPELINE_CONSUMED;
+        }
+        
+        // Released inside the term - a tap, sent ahead of anything buffered
+        decide(false);
+        return release_held(event);
+    }
+    
+    if (buffer_count >= TAP_HOLD_BUFFER_SIZE) {
+        decide(!pending.released);
+        return process_tap_hold(event);
+    }
+    
+    buffer[buffer_count++] = *event;
+    
+    if (event->pressed) {
+        buffered_presses |= position_bit(event);
+        
+        if (flags & TAP_HOLD_MULTI_TAP) {
+            // Another key ends the sequence
+            decide(!pending.released && (flags & TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS));
+        } else if (flags & TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS) {
+            decide(true);
+        }
+    } else if ((flags & TAP_HOLD_PERMISSIVE_HOLD) && (buffered_presses & position_bit(event))) {
+        // Another key was tapped entirely inside this one
+        decide(true);
+    }
+    
+    return PIPELINE_DEFERRED;
+}
+
+pipeline_result_t HOT_PATH(process_tap_hold)(key_event_t *event) {
+    if (pending.active) {
+        // The term ran out before this event arrived
+        if (!timer_before_us(event->time_us, pending.deadline_us)) {
+            decide(!pending.released);
+            return process_tap_hold(event);
+        }
+        return process_pending(event);
+    }
+    
+    if (!event->pressed) {
+        return release_held(event);
+    }
+    
+    held_interrupted |= held_positions;
+    
+    // Pressed soon after the previous key - typing, not reaching for a modifier.
+    // Elapsed time rather than a deadline compare, which turns true again
+    // once the idle gap passes half the 32-bit clock.
+    bool streak = last_press_valid &&
+                  event->time_us - last_press_us < TIMER_MS_TO_US(TAP_HOLD_STREAK_TERM);
+    last_press_us = event->time_us;
+    last_press_valid = true;
+    
+    const tap_hold_behavior_t *behavior = event->remapped ? NULL : behavior_for(event->keycode);
+    if (behavior == NULL) return PIPELINE_CONTINUE;
+    
+    pending.behavior = behavior;
+    pending.press = *event;
+    pending.flags = key_flags(behavior, event);
+    pending.count = 1;
+    pending.released = false;
+    pending.deadline_us = event->time_us + term_us(behavior, event);
+    pending.active = true;
+    
+    if (streak && (pending.flags & TAP_HOLD_STREAK)) {
+        decide(false);
+        return PIPELINE_CONSUMED;
+    }
+    
+    deadline_schedule(&pending_deadline, pending.deadline_us);
+    return PIPELINE_DEFERRED;
+}
+
+// The term ran out with nothing else deciding the key
+static void pending_expired(void *ctx) {
+    (void)ctx;
+    if (pending.active) {
+        decide(!pending.released);
+        send_hid_report();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef TAP_HOLD_H
+#define TAP_HOLD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pipeline.h"
+
+// Decision strategies
+#define TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS (1 << 0)  // Any other key press decides hold
+#define TAP_HOLD_PERMISSIVE_HOLD         (1 << 1)  // Another key tapped inside decides hold
+#define TAP_HOLD_RETRO_TAP               (1 << 2)  // Held past the term alone still taps
+#define TAP_HOLD_MULTI_TAP               (1 << 3)  // Wait for further taps after release
+#define TAP_HOLD_STREAK                  (1 << 4)  // Tap at once when pressed mid typing streak
+
+#define TAP_HOLD_BUFFER_SIZE 16  // Events held back while a decision is pending
+#define TAP_HOLD_POSITIONS   (MATRIX_ROWS * KEYMAP_COLS)
+_Static_assert(TAP_HOLD_POSITIONS <= 64, "Tap-hold position masks are 64 bits");
+
+// What a tap-hold key does once decided. Each action is called with
+// pressed = true on the decision and pressed = false on release;
+// `count` is the number of presses in the sequence.
+typedef struct {
+    uint8_t flags;
+    uint16_t term_ms;
+    uint16_t (*get_term)(const key_event_t *event);  // Per-key term, optional
+    uint8_t (*get_flags)(const key_event_t *event);  // Per-key flags, optional
+    void (*on_tap)(const key_event_t *event, uint8_t count, bool pressed);
+    void (*on_hold)(const key_event_t *event, uint8_t count, bool pressed);
+    void (*on_release)(const key_event_t *press, bool hold, uint32_t held_us);  // Optional
+} tap_hold_behavior_t;
+
+void tap_hold_init(void);
+void tap_hold_set_stage(uint8_t stage);
+pipeline_result_t process_tap_hold(key_event_t *event);
+
+// Send a keycode on to the stages after the tap-hold engine
+void tap_hold_emit(const key_event_t *event, uint16_t keycode, bool pressed);
+
+#endif // TAP_HOLD_H
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "tap_hold.h"
 
 typedef void (*td_fn_t)(uint8_t tap_count);
 
@@ -11,9 +12,11 @@ typedef struct {
     uint16_t kc_double;
     td_fn_t on_dance_finished;
     td_fn_t on_reset;
+    uint16_t kc_hold;  // Key while the final tap is held, KC_NO to use the tap action
+    uint16_t term;     // Tap dance term in ms, 0 for TAP_DANCE_TERM
 } tap_dance_action_t;
 
-bool process_tap_dance(uint16_t keycode, bool pressed, uint8_t row, uint8_t col);
-void tap_dance_task(void);
+// Tap dance keys are decided by the tap-hold engine
+extern const tap_hold_behavior_t tap_dance_behavior;
 
-#endif // TAPDANCE_H
\ No newline at end of file
+#endif // TAPDANCE_H
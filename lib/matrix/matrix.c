@@ -23,7 +23,7 @@ void matrix_init(void) {
 }
 
 void matrix_scan(void) {
-    uint32_t now = timer_read();
+    uint32_t now = timer_read_us();
     
     // Save previous state
     for (int i = 0; i < MATRIX_ROWS; i++) {
@@ -45,7 +45,7 @@ void matrix_scan(void) {
                     // Not debouncing, start timer
                     matrix.debounce_timer[row][col] = now;
                     *state |= 0x80;  // Set debouncing flag
-                } else if (timer_elapsed(matrix.debounce_timer[row][col]) >= DEBOUNCE_MS) {
+                } else if (timer_elapsed_us(matrix.debounce_timer[row][col]) >= TIMER_MS_TO_US(DEBOUNCE_MS)) {
                     // Debounce complete
                     *state = pressed ? 0x01 : 0x00;
                     
@@ -8,7 +8,7 @@
 typedef struct {
     uint8_t current[MATRIX_ROWS];
     uint8_t previous[MATRIX_ROWS];
-    uint32_t debounce_timer[MATRIX_ROWS][MATRIX_COLS];
+    uint32_t debounce_timer[MATRIX_ROWS][MATRIX_COLS];  // Microseconds
     uint8_t debounce_state[MATRIX_ROWS][MATRIX_COLS];
 } matrix_t;
 
@@ -0,0 +1,178 @@
+#include "deadline.h"
+#include "timer.h"
+
+static deadline_t *heap[DEADLINE_MAX];
+static uint8_t heap_size = 0;
+static deadline_stats_t stats = {0};
+
+
+static inline void place(uint8_t index, deadline_t *deadline) {
+    heap[index] = deadline;
+    deadline->slot = index;
+}
+
+static void sift_up(uint8_t index) {
+    deadline_t *deadline = heap[index];
+    
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!timer_before_us(deadline->when_us, heap[parent]->when_us)) break;
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, deadline);
+}
+
+static void sift_down(uint8_t index) {
+    deadline_t *deadline = heap[index];
+    
+    while (true) {
+        uint8_t child = index * 2 + 1;
+        if (child >= heap_size) break;
+        
+        if (child + 1 < heap_size && timer_before_us(heap[child + 1]->when_us, heap[child]->when_us)) {
+            child++;
+        }
+        if (!timer_before_us(heap[child]->when_us, deadline->when_us)) break;
+        
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, deadline);
+}
+
+static void remove_at(uint8_t index) {
+    heap[index]->slot = DEADLINE_IDLE;
+    heap_size--;
+    
+    if (index == heap_size) return;
+    
+    // Fill the hole with the last entry and restore heap order around it
+    deadline_t *moved = heap[heap_size];
+    place(index, moved);
+    sift_down(index);
+    sift_up(moved->slot);
+}
+
+#ifndef TIMER_VIRTUAL
+static alarm_id_t alarm_id = 0;
+static uint32_t alarm_when_us = 0;
+
+// The alarm only has to wake the core; the work happens in deadline_task
+static int64_t deadline_alarm_callback(alarm_id_t id, void *user_data) {
+    (void)id; (void)user_data;
+    return 0;
+}
+
+static void disarm_alarm(void) {
+    if (alarm_id > 0) {
+        cancel_alarm(alarm_id);
+        alarm_id = 0;
+    }
+}
+
+// Keep the hardware alarm on the earliest deadline
+static void arm_alarm(void) {
+    if (heap_size == 0) return;
+    
+    uint32_t when_us = heap[0]->when_us;
+    if (alarm_id > 0 && alarm_when_us == when_us) return;
+    
+    disarm_alarm();
+    
+    uint32_t now = timer_read_us();
+    if (!timer_before_us(now, when_us)) return;  // Already due
+    
+    alarm_id = add_alarm_at(delayed_by_us(get_absolute_time(), when_us - now),
+                            deadline_alarm_callback, NULL, true);
+    alarm_when_us = when_us;
+}
+#else
+// The virtual clock has no alarm to arm
+static inline void arm_alarm(void) {}
+static inline void disarm_alarm(void) {}
+#endif
+
+void deadline_init(void) {
+    for (uint8_t i = 0; i < heap_size; i++) {
+        heap[i]->slot = DEADLINE_IDLE;
+    }
+    heap_size = 0;
+    
+    disarm_alarm();
+}
+
+bool deadline_schedule(deadline_t *deadline, uint32_t when_us) {
+    if (deadline_pending(deadline)) {
+        // Move it in place
+        deadline->when_us = when_us;
+        sift_up(deadline->slot);
+        sift_down(deadline->slot);
+    } else {
+        if (heap_size >= DEADLINE_MAX) return false;
+        
+        deadline->when_us = when_us;
+        place(heap_size++, deadline);
+        sift_up(deadline->slot);
+        
+        if (heap_size > stats.depth_max) {
+            stats.depth_max = heap_size;
+        }
+    }
+    
+    arm_alarm();
+    return true;
+}
+
+void deadline_cancel(deadline_t *deadline) {
+    if (!deadline_pending(deadline)) return;
+    remove_at(deadline->slot);
+    arm_alarm();
+}
+
+void deadline_task(void) {
+    uint32_t now = timer_read_us();
+    
+    while (heap_size > 0 && !timer_before_us(now, heap[0]->when_us)) {
+        deadline_t *deadline = heap[0];
+        remove_at(0);
+        
+        uint32_t late_us = now - deadline->when_us;
+        stats.fired++;
+        stats.late_us_total += late_us;
+        if (late_us > stats.late_us_max) {
+            stats.late_us_max = late_us;
+        }
+        
+        // May reschedule itself or others
+        deadline->fn(deadline->ctx);
+        now = timer_read_us();
+    }
+    
+    arm_alarm();
+}
+
+uint32_t deadline_wait_us(uint32_t max_us) {
+    uint32_t wait_us = max_us;
+    
+    if (heap_size > 0) {
+        int32_t until = (int32_t)(heap[0]->when_us - timer_read_us());
+        if (until <= 0) {
+            wait_us = 0;
+        } else if ((uint32_t)until < wait_us) {
+            wait_us = until;
+        }
+    }
+    
+    return wait_us;
+}
+
+#ifndef TIMER_VIRTUAL
+absolute_time_t deadline_wake_time(uint32_t max_us) {
+    return delayed_by_us(get_absolute_time(), deadline_wait_us(max_us));
+}
+#endif
+
+const deadline_stats_t *get_deadline_stats(void) {
+    return &stats;
+}
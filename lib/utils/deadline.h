@@ -0,0 +1,56 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+// One-shot wakeups for feature timeouts, kept in a min-heap ordered by
+// expiry. A hardware alarm is armed for the earliest entry so the main
+// loop can sleep until it; callbacks run from deadline_task(), never
+// from interrupt context.
+
+#define DEADLINE_MAX  16
+#define DEADLINE_IDLE 0xFF
+
+typedef void (*deadline_fn_t)(void *ctx);
+
+typedef struct {
+    uint32_t when_us;
+    deadline_fn_t fn;
+    void *ctx;
+    uint8_t slot;  // Heap index, DEADLINE_IDLE when not scheduled
+} deadline_t;
+
+typedef struct {
+    uint32_t fired;
+    uint32_t late_us_max;
+    uint32_t late_us_total;
+    uint8_t depth_max;
+} deadline_stats_t;
+
+#define DEADLINE_INIT(fn, ctx) { 0, (fn), (ctx), DEADLINE_IDLE }
+
+void deadline_init(void);
+
+// Schedule (or move) a deadline; returns false if the heap is full
+bool deadline_schedule(deadline_t *deadline, uint32_t when_us);
+void deadline_cancel(deadline_t *deadline);
+
+static inline bool deadline_pending(const deadline_t *deadline) {
+    return deadline->slot != DEADLINE_IDLE;
+}
+
+// Run every expired deadline
+void deadline_task(void);
+
+// How long the main loop may sleep: until the next deadline, at most `max_us`
+uint32_t deadline_wait_us(uint32_t max_us);
+
+#ifndef TIMER_VIRTUAL
+absolute_time_t deadline_wake_time(uint32_t max_us);
+#endif
+
+const deadline_stats_t *get_deadline_stats(void);
+
+#endif // DEADLINE_H
@@ -0,0 +1,23 @@
+#ifndef HOT_PATH_H
+#define HOT_PATH_H
+
+#include "config.h"
+
+// Placement for the code and tables every key event runs through. With
+// RAM_HOT_PATH they are copied to SRAM at boot, so an XIP cache miss after
+// Wi-Fi or USB work cannot stall event processing. Otherwise they stay in
+// flash and the markers expand to nothing.
+//
+//   static void HOT_PATH(fn)(args) { ... }
+//   const uint16_t table[] HOT_DATA(table) = { ... };
+
+#if RAM_HOT_PATH && !defined(TIMER_VIRTUAL)
+#include "pico.h"
+#define HOT_PATH(fn)    __not_in_flash_func(fn)
+#define HOT_DATA(name)  __not_in_flash(#name)
+#else
+#define HOT_PATH(fn)    fn
+#define HOT_DATA(name)
+#endif
+
+#endif // HOT_PATH_H
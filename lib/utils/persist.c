@@ -0,0 +1,102 @@
+#include "persist.h"
+#include <string.h>
+
+#ifndef TIMER_VIRTUAL
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint16_t length;
+    uint16_t reserved;
+    uint32_t checksum;
+} persist_header_t;
+
+_Static_assert(sizeof(persist_header_t) == PERSIST_BLOCK_SIZE - PERSIST_MAX_SIZE, "Header size");
+
+static uint8_t block[PERSIST_BLOCK_SIZE] __attribute__((aligned(4)));
+
+#ifndef TIMER_VIRTUAL
+_Static_assert(PERSIST_BLOCK_SIZE % FLASH_PAGE_SIZE == 0, "Flash programs whole pages");
+
+#define PERSIST_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+static const uint8_t *stored_block(void) {
+    return (const uint8_t *)(XIP_BASE + PERSIST_OFFSET);
+}
+
+// Runs with the other core and interrupts kept off flash
+static void write_block(void *param) {
+    (void)param;
+    flash_range_erase(PERSIST_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(PERSIST_OFFSET, block, PERSIST_BLOCK_SIZE);
+}
+
+static bool commit_block(void) {
+    return flash_safe_execute(write_block, NULL, 100) == PICO_OK;
+}
+#else
+static uint8_t virtual_flash[PERSIST_BLOCK_SIZE];
+
+static const uint8_t *stored_block(void) {
+    return virtual_flash;
+}
+
+static bool commit_block(void) {
+    memcpy(virtual_flash, block, PERSIST_BLOCK_SIZE);
+    return true;
+}
+#endif
+
+// FNV-1a
+static uint32_t checksum(const uint8_t *data, uint16_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint16_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static const uint8_t *find_record(uint32_t magic, uint16_t length) {
+    const uint8_t *stored = stored_block();
+    persist_header_t header;
+    memcpy(&header, stored, sizeof(header));
+    
+    if (header.magic != magic || header.length != length) return NULL;
+    
+    const uint8_t *data = stored + sizeof(header);
+    if (checksum(data, length) != header.checksum) return NULL;
+    return data;
+}
+
+bool persist_load(uint32_t magic, void *data, uint16_t length) {
+    if (length > PERSIST_MAX_SIZE) return false;
+    
+    const uint8_t *record = find_record(magic, length);
+    if (record == NULL) return false;
+    
+    memcpy(data, record, length);
+    return true;
+}
+
+bool persist_save(uint32_t magic, const void *data, uint16_t length) {
+    if (length > PERSIST_MAX_SIZE) return false;
+    
+    // Spare the flash an erase when nothing changed
+    const uint8_t *record = find_record(magic, length);
+    if (record && memcmp(record, data, length) == 0) return true;
+    
+    persist_header_t header = {
+        .magic = magic,
+        .length = length,
+        .reserved = 0xFFFF,
+        .checksum = checksum(data, length)
+    };
+    
+    memset(block, 0xFF, sizeof(block));
+    memcpy(block, &header, sizeof(header));
+    memcpy(block + sizeof(header), data, length);
+    
+    return commit_block();
+}
@@ -0,0 +1,19 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A single settings record kept in the last sector of flash, checked by
+// magic, length and checksum. Host builds (TIMER_VIRTUAL) keep it in RAM.
+
+#define PERSIST_BLOCK_SIZE 1024  // Whole flash pages
+#define PERSIST_MAX_SIZE   (PERSIST_BLOCK_SIZE - 12)  // Less the header
+
+// Copy the stored record into `data`; false if there is none that matches
+bool persist_load(uint32_t magic, void *data, uint16_t length);
+
+// Replace the stored record; skipped when it already holds the same data
+bool persist_save(uint32_t magic, const void *data, uint16_t length);
+
+#endif // PERSIST_H
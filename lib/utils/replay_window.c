@@ -0,0 +1,53 @@
+#include "replay_window.h"
+
+void replay_window_init(replay_window_t *window) {
+    window->bitmap = 0;
+    window->highest = 0;
+    window->position = 0;
+    window->initialised = false;
+}
+
+void replay_window_restart(replay_window_t *window) {
+    window->bitmap = 0;
+    window->initialised = false;
+}
+
+replay_result_t replay_window_check(replay_window_t *window, uint16_t sequence) {
+    // Wrap-safe distance from the newest accepted sequence
+    int16_t diff = (int16_t)(sequence - window->highest);
+    
+    if (!window->initialised) {
+        // Jump a whole window so late packets of the new run still order
+        // after everything accepted before it
+        window->bitmap = 1;
+        window->highest = sequence;
+        window->position += REPLAY_WINDOW_SIZE;
+        window->initialised = true;
+        return REPLAY_NEW;
+    }
+    
+    if (diff > 0) {
+        // Slide the window forward
+        window->bitmap = (diff >= REPLAY_WINDOW_SIZE) ? 0 : window->bitmap << diff;
+        window->bitmap |= 1;
+        window->highest = sequence;
+        window->position += diff;
+        return REPLAY_NEW;
+    }
+    
+    uint16_t offset = (uint16_t)(-diff);
+    if (offset >= REPLAY_STALE_DISTANCE) {
+        return REPLAY_STALE;
+    }
+    if (offset >= REPLAY_WINDOW_SIZE) {
+        return REPLAY_TOO_OLD;
+    }
+    
+    uint64_t bit = (uint64_t)1 << offset;
+    if (window->bitmap & bit) {
+        return REPLAY_DUPLICATE;
+    }
+    
+    window->bitmap |= bit;
+    return REPLAY_LATE;
+}
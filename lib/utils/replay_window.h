@@ -0,0 +1,54 @@
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Sliding-window duplicate detection for 16-bit packet sequence numbers,
+// in the style of IPsec anti-replay. Bit n of the bitmap records whether
+// sequence (highest - n) has been accepted, so out-of-order packets inside
+// the window are accepted exactly once.
+#define REPLAY_WINDOW_SIZE 64
+
+// A sequence this far behind is either a very stale copy or a peer that
+// restarted without saying so. Neither is accepted: only an explicit
+// replay_window_restart() moves the window back.
+#define REPLAY_STALE_DISTANCE 4096
+
+typedef struct {
+    uint64_t bitmap;
+    uint16_t highest;
+    uint32_t position;  // Extended sequence of `highest`, see replay_window_position()
+    bool initialised;
+} replay_window_t;
+
+typedef enum {
+    REPLAY_NEW,        // Newest sequence seen so far
+    REPLAY_LATE,       // Older than the newest, but not seen before
+    REPLAY_DUPLICATE,  // Already accepted
+    REPLAY_TOO_OLD,    // Fell out of the back of the window
+    REPLAY_STALE       // REPLAY_STALE_DISTANCE or more behind, waits for a restart
+} replay_result_t;
+
+void replay_window_init(replay_window_t *window);
+
+// Forget the peer's sequence after it went away or rebooted; the next
+// sequence checked is taken as the start of its new run. Positions keep
+// counting, so anything stamped before the restart stays older than what
+// follows.
+void replay_window_restart(replay_window_t *window);
+replay_result_t replay_window_check(replay_window_t *window, uint16_t sequence);
+
+static inline bool replay_window_accepted(replay_result_t result) {
+    return result == REPLAY_NEW || result == REPLAY_LATE;
+}
+
+// Position of an accepted sequence on a 32-bit count that keeps growing
+// across 16-bit wraps and peer restarts, so updates can be ordered long
+// after the raw sequence has wrapped. Starts at REPLAY_WINDOW_SIZE after
+// init, so 0 is older than any accepted packet.
+static inline uint32_t replay_window_position(const replay_window_t *window, uint16_t sequence) {
+    return window->position - (uint16_t)(window->highest - sequence);
+}
+
+#endif // REPLAY_WINDOW_H
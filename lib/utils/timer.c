@@ -1,3 +1,6 @@
 #include "timer.h"
 
-// Timer implementation is header-only for this simple case
\ No newline at end of file
+// Timer implementation is header-only apart from the virtual clock
+#ifdef TIMER_VIRTUAL
+uint32_t timer_virtual_us = 0;
+#endif
@@ -2,18 +2,86 @@
 #define TIMER_H
 
 #include <stdint.h>
-#include "pico/stdlib.h"
+#include <stdbool.h>
+
+// Microsecond timebase. Timestamps are 32-bit and wrap every ~71 minutes,
+// so compare them only through the helpers below, never with < or >.
+
+#ifdef TIMER_VIRTUAL
+// Host builds: a clock that only moves when told to, for deterministic
+// timing tests
+extern uint32_t timer_virtual_us;
+
+static inline uint32_t timer_read_us(void) {
+    return timer_virtual_us;
+}
+
+static inline void timer_virtual_advance_us(uint32_t us) {
+    timer_virtual_us += us;
+}
 
 static inline uint32_t timer_read(void) {
-    return to_ms_since_boot(get_absolute_time());
+    return timer_virtual_us / 1000;
 }
 
-static inline uint32_t timer_elapsed(uint32_t last) {
-    return timer_read() - last;
+static inline void wait_ms(uint32_t ms) {
+    timer_virtual_advance_us(ms * 1000);
+}
+
+// No cycle counter on the host - count virtual microseconds instead
+static inline void timer_cycles_init(void) {
+}
+
+static inline uint32_t timer_read_cycles(void) {
+    return timer_virtual_us;
+}
+#else
+#include "pico/stdlib.h"
+#include "hardware/structs/m33.h"
+
+static inline uint32_t timer_read_us(void) {
+    return time_us_32();
+}
+
+static inline uint32_t timer_read(void) {
+    return to_ms_since_boot(get_absolute_time());
 }
 
 static inline void wait_ms(uint32_t ms) {
     sleep_ms(ms);
 }
 
-#endif // TIMER_H
\ No newline at end of file
+// Core cycle counter (DWT CYCCNT), for costs too small for the
+// microsecond timer. Wraps every ~28 s at 150 MHz.
+static inline void timer_cycles_init(void) {
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+static inline uint32_t timer_read_cycles(void) {
+    return m33_hw->dwt_cyccnt;
+}
+#endif
+
+#define TIMER_MS_TO_US(ms) ((uint32_t)(ms) * 1000u)
+
+static inline uint32_t timer_elapsed_us(uint32_t since) {
+    return timer_read_us() - since;
+}
+
+// True if `a` is earlier than `b`
+static inline bool timer_before_us(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+// True once `deadline` has been reached
+static inline bool timer_expired_us(uint32_t deadline) {
+    return !timer_before_us(timer_read_us(), deadline);
+}
+
+static inline uint32_t timer_elapsed(uint32_t last) {
+    return timer_read() - last;
+}
+
+#endif // TIMER_H
@@ -2,6 +2,7 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
+#include "pico/rand.h"
 #include "hardware/gpio.h"
 #include "lwip/pbuf.h"
 #include "lwip/udp.h"
@@ -23,11 +24,12 @@ static keyboard_packet_t tx_packet;
 static keyboard_packet_t rx_packet;
 static uint8_t previous_matrix[MATRIX_ROWS] = {0};
 static uint16_t packet_sequence = 0;
+static uint32_t boot_id = 0;  // Sent with every heartbeat, new on each power-up
 
 // Transmission buffer for reliable delivery
 typedef struct {
     matrix_state_t data;
-    uint32_t timestamp;
+    uint32_t timestamp;  // Microseconds
     uint16_t sequence;
     uint8_t retry_count;
     bool active;
@@ -77,7 +79,7 @@ void send_matrix_update(matrix_state_t *matrix, uint16_t seq) {
     tx_packet.type = PACKET_MATRIX_UPDATE;
     tx_packet.device_id = DEVICE_ID;
     tx_packet.sequence = seq;
-    tx_packet.timestamp = timer_read();
+    tx_packet.timestamp = timer_read_us();
     memcpy(tx_packet.data, matrix, sizeof(matrix_state_t));
     tx_packet.checksum = calculate_checksum(&tx_packet);
     
@@ -94,12 +96,13 @@ void add_to_buffer(matrix_state_t *matrix) {
         }
     }
     
-    // If no free slot, clear oldest completed entry
+    // If no free slot, clear oldest completed entry (by age, wrap-safe)
+    uint32_t now = timer_read_us();
     if (slot == -1) {
-        uint32_t oldest_time = 0xFFFFFFFF;
+        uint32_t oldest_age = 0;
         for (int i = 0; i < BUFFER_SIZE; i++) {
-            if (tx_buffer[i].acked && tx_buffer[i].timestamp < oldest_time) {
-                oldest_time = tx_buffer[i].timestamp;
+            if (tx_buffer[i].acked && now - tx_buffer[i].timestamp >= oldest_age) {
+                oldest_age = now - tx_buffer[i].timestamp;
                 slot = i;
             }
         }
@@ -107,10 +110,10 @@ void add_to_buffer(matrix_state_t *matrix) {
     
     // If still no slot (all unacked), force clear oldest
     if (slot == -1) {
-        uint32_t oldest_time = 0xFFFFFFFF;
+        uint32_t oldest_age = 0;
         for (int i = 0; i < BUFFER_SIZE; i++) {
-            if (tx_buffer[i].timestamp < oldest_time) {
-                oldest_time = tx_buffer[i].timestamp;
+            if (now - tx_buffer[i].timestamp >= oldest_age) {
+                oldest_age = now - tx_buffer[i].timestamp;
                 slot = i;
             }
         }
@@ -119,7 +122,7 @@ void add_to_buffer(matrix_state_t *matrix) {
     // Add to buffer
     if (slot >= 0) {
         tx_buffer[slot].data = *matrix;
-        tx_buffer[slot].timestamp = timer_read();
+        tx_buffer[slot].timestamp = now;
         tx_buffer[slot].sequence = packet_sequence++;
         tx_buffer[slot].retry_count = 0;
         tx_buffer[slot].active = true;
@@ -131,7 +134,7 @@ void add_to_buffer(matrix_state_t *matrix) {
 }
 
 void process_tx_buffer() {
-    uint32_t now = timer_read();
+    uint32_t now = timer_read_us();
     
     for (int i = 0; i < BUFFER_SIZE; i++) {
         if (!tx_buffer[i].active || tx_buffer[i].acked) continue;
@@ -139,7 +142,7 @@ void process_tx_buffer() {
         uint32_t age = now - tx_buffer[i].timestamp;
         
         // Retransmit if needed
-        if (tx_buffer[i].retry_count > 0 && age > RETRANSMIT_DELAY_MS) {
+        if (tx_buffer[i].retry_count > 0 && age > TIMER_MS_TO_US(RETRANSMIT_DELAY_MS)) {
             if (tx_buffer[i].retry_count < MAX_RETRIES) {
                 send_matrix_update(&tx_buffer[i].data, tx_buffer[i].sequence);
                 tx_buffer[i].retry_count++;
@@ -148,7 +151,7 @@ void process_tx_buffer() {
         }
         
         // Clear from buffer after max retries or timeout
-        if (tx_buffer[i].retry_count >= MAX_RETRIES || age > RETRANSMIT_TIMEOUT_MS) {
+        if (tx_buffer[i].retry_count >= MAX_RETRIES || age > TIMER_MS_TO_US(RETRANSMIT_TIMEOUT_MS)) {
             tx_buffer[i].active = false;
         }
     }
@@ -304,6 +307,10 @@ int main() {
     memset(tx_buffer, 0, sizeof(tx_buffer));
     memset(previous_matrix, 0, sizeof(previous_matrix));
     
+    // The first heartbeat goes out on the first pass, ahead of any matrix
+    // update, so the dongle sees the new boot ID before the new sequences
+    boot_id = get_rand_32();
+    
     // Main loop variables
     uint32_t last_heartbeat = 0;
     uint32_t last_buffer_check = 0;
@@ -314,7 +321,7 @@ int main() {
     
     // Main loop - scan matrix and send changes
     while (1) {
-        uint32_t loop_start = timer_read();
+        uint32_t loop_start = timer_read_us();
         
         // Always poll WiFi first
         cyw43_arch_poll();
@@ -380,8 +387,10 @@ int main() {
             tx_packet.type = PACKET_HEARTBEAT;
             tx_packet.device_id = DEVICE_ID;
             tx_packet.sequence = packet_sequence++;
-            tx_packet.timestamp = now;
+            tx_packet.timestamp = timer_read_us();
             memset(tx_packet.data, 0, sizeof(tx_packet.data));
+            heartbeat_t heartbeat = { .boot_id = boot_id };
+            memcpy(tx_packet.data, &heartbeat, sizeof(heartbeat));
             tx_packet.checksum = calculate_checksum(&tx_packet);
             
             send_packet(&tx_packet);
@@ -431,10 +440,10 @@ int main() {
         }
         
         // Ensure consistent loop timing
-        uint32_t loop_time = timer_read() - loop_start;
-        if (loop_time < 1) {
+        uint32_t loop_time = timer_elapsed_us(loop_start);
+        if (loop_time < 1000) {
             // Loop took less than 1ms, sleep for the remainder
-            sleep_us((1 - loop_time) * 1000);
+            sleep_us(1000 - loop_time);
         }
         // If loop took more than 1ms, continue immediately (we're behind)
     }
@@ -0,0 +1,141 @@
+// Combo stage cost with MAX_COMBOS combos of two and three keys spread
+// over a 48-key single-layer keymap: typing that never completes a combo,
+// and chords that do
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "keycodes.h"
+#include "combos.h"
+#include "layers.h"
+#include "deadline.h"
+#include "timer.h"
+#include "keymap_tables.h"
+
+#define POSITIONS (MATRIX_ROWS * KEYMAP_COLS)
+#define KEY_AT(p) (KC_A + (p))  // A distinct keycode per position
+
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] = {
+    {
+        { KEY_AT(0),  KEY_AT(1),  KEY_AT(2),  KEY_AT(3),  KEY_AT(4),  KEY_AT(5),
+          KEY_AT(6),  KEY_AT(7),  KEY_AT(8),  KEY_AT(9),  KEY_AT(10), KEY_AT(11) },
+        { KEY_AT(12), KEY_AT(13), KEY_AT(14), KEY_AT(15), KEY_AT(16), KEY_AT(17),
+          KEY_AT(18), KEY_AT(19), KEY_AT(20), KEY_AT(21), KEY_AT(22), KEY_AT(23) },
+        { KEY_AT(24), KEY_AT(25), KEY_AT(26), KEY_AT(27), KEY_AT(28), KEY_AT(29),
+          KEY_AT(30), KEY_AT(31), KEY_AT(32), KEY_AT(33), KEY_AT(34), KEY_AT(35) },
+        { KEY_AT(36), KEY_AT(37), KEY_AT(38), KEY_AT(39), KEY_AT(40), KEY_AT(41),
+          KEY_AT(42), KEY_AT(43), KEY_AT(44), KEY_AT(45), KEY_AT(46), KEY_AT(47) },
+    }
+};
+const uint8_t keymap_layer_count = 1;
+const keymap_defined_t keymap_defined_layers = {
+    .layers = { [0 ... MATRIX_ROWS - 1] = { [0 ... KEYMAP_COLS - 1] = 1 } }
+};
+
+// Combo n: positions 7n, 7n + 1..11 and, for odd n, 7n + 20..32 (mod 48),
+// so every combo is distinct and its keys never collide
+#define COMBO_A(n) ((7 * (n)) % POSITIONS)
+#define COMBO_B(n) ((7 * (n) + 1 + (n) % 11) % POSITIONS)
+#define COMBO_C(n) ((7 * (n) + 20 + (n) % 13) % POSITIONS)
+#define COMBO_KEYS(n) { KEY_AT(COMBO_A(n)), KEY_AT(COMBO_B(n)), KEY_AT(COMBO_C(n)) },
+#define COMBO_ENTRY(n) { combo_keys[n], 2 + (n) % 2, KC_F1 + (n) % 12 },
+
+#define REPEAT4(X, n)   X(n) X((n) + 1) X((n) + 2) X((n) + 3)
+#define REPEAT16(X, n)  REPEAT4(X, n) REPEAT4(X, (n) + 4) REPEAT4(X, (n) + 8) REPEAT4(X, (n) + 12)
+#define REPEAT64(X, n)  REPEAT16(X, n) REPEAT16(X, (n) + 16) REPEAT16(X, (n) + 32) REPEAT16(X, (n) + 48)
+#define REPEAT256(X)    REPEAT64(X, 0) REPEAT64(X, 64) REPEAT64(X, 128) REPEAT64(X, 192)
+
+_Static_assert(MAX_COMBOS == 256, "Benchmark table is written for 256 combos");
+
+static const uint16_t combo_keys[MAX_COMBOS][3] = { REPEAT256(COMBO_KEYS) };
+const combo_t key_combos[MAX_COMBOS] = { REPEAT256(COMBO_ENTRY) };
+const uint16_t combo_count = MAX_COMBOS;
+
+// Stage behind the combos: counts what comes out
+static uint32_t outputs;
+static uint32_t combo_outputs;
+
+static pipeline_result_t sink_stage(key_event_t *event) {
+    outputs++;
+    if (event->remapped) combo_outputs++;
+    return PIPELINE_CONSUMED;
+}
+
+// Nothing to report to
+void send_hid_report(void) {
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void key(uint8_t position, bool pressed) {
+    pipeline_process_key(position / KEYMAP_COLS, position % KEYMAP_COLS, pressed, 1);
+}
+
+// Let the combo window close
+static void settle(void) {
+    timer_virtual_advance_us(TIMER_MS_TO_US(COMBO_TERM) + 1000);
+    deadline_task();
+}
+
+int main(void) {
+    deadline_init();
+    layers_init();
+    pipeline_init();
+    
+    uint64_t start = now_ns();
+    init_combos();
+    uint64_t init_ns = now_ns() - start;
+    
+    combos_set_stage(pipeline_register("combo", process_combo, PIPELINE_ALL_KEYS));
+    pipeline_register("sink", sink_stage, PIPELINE_ALL_KEYS);
+    
+    const combo_stats_t *stats = get_combo_stats();
+    CHECK_EQ(stats->dropped, 0);
+    CHECK_EQ(stats->variants, MAX_COMBOS);
+    printf("%u combos, %u variants, init %.1f us\n", MAX_COMBOS, stats->variants, init_ns / 1000.0);
+    
+    // Every combo fires from its chord
+    uint64_t chord_ns = 0;
+    uint32_t chord_events = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int n = 0; n < MAX_COMBOS; n++) {
+            uint8_t positions[3] = { COMBO_A(n), COMBO_B(n), COMBO_C(n) };
+            uint8_t count = 2 + n % 2;
+            uint32_t fired = combo_outputs;
+            
+            start = now_ns();
+            for (uint8_t i = 0; i < count; i++) key(positions[i], true);
+            for (uint8_t i = 0; i < count; i++) key(positions[i], false);
+            chord_ns += now_ns() - start;
+            chord_events += count * 2;
+            settle();
+            
+            // A two-key combo that is a prefix of a three-key one fires on
+            // its release instead, but it fires
+            CHECK_EQ(combo_outputs - fired, 2);
+        }
+    }
+    
+    // Rolling taps with a key between them: keys wait out the window only
+    // when they start a combo
+    enum { TAPS = 200000 };
+    uint32_t before = outputs;
+    uint64_t typing_ns = 0;
+    for (int i = 0; i < TAPS; i++) {
+        uint8_t position = (i * 5) % POSITIONS;
+        start = now_ns();
+        key(position, true);
+        key(position, false);
+        typing_ns += now_ns() - start;
+        if (i % 64 == 63) settle();
+    }
+    settle();
+    CHECK_EQ(outputs - before, TAPS * 2);
+    
+    printf("chords: %.1f ns/event\n", (double)chord_ns / chord_events);
+    printf("typing: %.1f ns/event\n", (double)typing_ns / (TAPS * 2));
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Keycode dispatch and HID translation per event: the class table and
+// flat usage table against the range-check cascade and switch they
+// replaced, over the keycodes of the default keymap
+#include <time.h>
+#include "test.h"
+#include "keycodes.h"
+#include "keycode_class.h"
+#include "keymap_layout.h"
+#include "usb_hid.h"
+
+static const uint16_t layout[][MATRIX_ROWS][KEYMAP_COLS] = KEYMAP_LAYOUT;
+#define LAYOUT_CELLS (sizeof(layout) / sizeof(uint16_t))
+
+#define STREAM_SIZE 4096
+#define ROUNDS 4000
+
+static uint16_t stream[STREAM_SIZE];        // Every keycode in the keymap
+static uint16_t basic_stream[STREAM_SIZE];  // Only the basic ones
+
+// The checks each processor made in turn before the class table, in
+// pipeline order: tap dance, mod-tap, layer, one-shot, then mouse,
+// autoclicker and reset ahead of the basic fallback
+static keycode_class_t classify_by_cascade(uint16_t keycode) {
+    if ((keycode & 0xFF00) == TD(0)) return KC_CLASS_TAPDANCE;
+    if ((keycode & 0xFF00) >= 0xE000 && (keycode & 0xFF00) <= 0xE700) return KC_CLASS_MODTAP;
+    
+    switch (keycode & 0xFF00) {
+        case MO(0):
+        case TG(0):
+        case TO(0):
+        case TT(0):
+            return KC_CLASS_LAYER;
+    }
+    
+    if ((keycode & 0xFF00) == OSL(0)) return KC_CLASS_ONESHOT;
+    if ((keycode & 0xFF00) == OSM(0)) return KC_CLASS_ONESHOT;
+    if ((keycode & 0xFF00) == (KC_MS_UP & 0xFF00)) return KC_CLASS_MOUSE;
+    if ((keycode & 0xFF00) == (KC_AC_TOGGLE & 0xFF00)) return KC_CLASS_AUTOCLICKER;
+    if (keycode == RESET) return KC_CLASS_SYSTEM;
+    if ((keycode & 0xFF00) == MACRO(0)) return KC_CLASS_MACRO;
+    if ((keycode & 0xFF00) == (KC_COPY & 0xFF00)) return KC_CLASS_CUSTOM;
+    if (keycode <= 0xFF) return KC_CLASS_BASIC;
+    return KC_CLASS_UNKNOWN;
+}
+
+// qmk_to_hid before the flat table
+static uint8_t translate_by_switch(uint16_t keycode) {
+    if (keycode >= KC_A && keycode <= KC_0) {
+        return (uint8_t)keycode;
+    }
+    
+    switch (keycode) {
+        case KC_ENT:  return 0x28;
+        case KC_ESC:  return 0x29;
+        case KC_BSPC: return 0x2A;
+        case KC_TAB:  return 0x2B;
+        case KC_SPC:  return 0x2C;
+        case KC_MINS: return 0x2D;
+        case KC_EQL:  return 0x2E;
+        case KC_LBRC: return 0x2F;
+        case KC_RBRC: return 0x30;
+        case KC_BSLS: return 0x31;
+        case KC_SCLN: return 0x33;
+        case KC_QUOT: return 0x34;
+        case KC_GRV:  return 0x35;
+        case KC_COMM: return 0x36;
+        case KC_DOT:  return 0x37;
+        case KC_SLSH: return 0x38;
+        case KC_CAPS: return 0x39;
+        case KC_F1:   return 0x3A;
+        case KC_F2:   return 0x3B;
+        case KC_F3:   return 0x3C;
+        case KC_F4:   return 0x3D;
+        case KC_F5:   return 0x3E;
+        case KC_F6:   return 0x3F;
+        case KC_F7:   return 0x40;
+        case KC_F8:   return 0x41;
+        case KC_F9:   return 0x42;
+        case KC_F10:  return 0x43;
+        case KC_F11:  return 0x44;
+        case KC_F12:  return 0x45;
+        case KC_INS:  return 0x49;
+        case KC_HOME: return 0x4A;
+        case KC_PGUP: return 0x4B;
+        case KC_DEL:  return 0x4C;
+        case KC_END:  return 0x4D;
+        case KC_PGDN: return 0x4E;
+        case KC_RIGHT:return 0x4F;
+        case KC_LEFT: return 0x50;
+        case KC_DOWN: return 0x51;
+        case KC_UP:   return 0x52;
+        default:
+            if (keycode < 0xFF) {
+                return (uint8_t)keycode;
+            }
+            return 0;
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void build_streams(void) {
+    const uint16_t *cells = &layout[0][0][0];
+    uint16_t basic[LAYOUT_CELLS];
+    uint32_t basic_count = 0;
+    uint32_t state = 1;
+    
+    for (uint32_t i = 0; i < LAYOUT_CELLS; i++) {
+        if (keycode_class(cells[i]) == KC_CLASS_BASIC && cells[i] != KC_TRNS && cells[i] != KC_NO) {
+            basic[basic_count++] = cells[i];
+        }
+    }
+    CHECK(basic_count > 0);
+    
+    for (uint32_t i = 0; i < STREAM_SIZE; i++) {
+        state = state * 1103515245u + 12345u;
+        stream[i] = cells[(state >> 8) % LAYOUT_CELLS];
+        basic_stream[i] = basic[(state >> 8) % basic_count];
+    }
+}
+
+// The old and new versions agree on every keycode the keymap uses
+static void check_equivalent(void) {
+    for (uint32_t i = 0; i < STREAM_SIZE; i++) {
+        CHECK_EQ(classify_by_cascade(stream[i]), keycode_class(stream[i]));
+        CHECK_EQ(translate_by_switch(basic_stream[i]), qmk_to_hid(basic_stream[i]));
+    }
+}
+
+#define TIME_PER_EVENT(fn, keys) ({ \
+    volatile uint32_t sink_ = 0; \
+    uint64_t start_ = now_ns(); \
+    for (int round_ = 0; round_ < ROUNDS; round_++) { \
+        uint32_t sum_ = 0; \
+        for (int i_ = 0; i_ < STREAM_SIZE; i_++) sum_ += fn((keys)[i_]); \
+        sink_ += sum_; \
+    } \
+    (void)sink_; \
+    (double)(now_ns() - start_) / ((double)ROUNDS * STREAM_SIZE); \
+})
+
+int main(void) {
+    build_streams();
+    check_equivalent();
+    
+    double cascade_ns = TIME_PER_EVENT(classify_by_cascade, stream);
+    double table_ns = TIME_PER_EVENT(keycode_class, stream);
+    double switch_ns = TIME_PER_EVENT(translate_by_switch, basic_stream);
+    double flat_ns = TIME_PER_EVENT(qmk_to_hid, basic_stream);
+    
+    printf("dispatch: cascade %.2f ns/event, class table %.2f ns/event\n", cascade_ns, table_ns);
+    printf("hid:      switch %.2f ns/event, flat table %.2f ns/event\n", switch_ns, flat_ns);
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Keycode lookup through a deep stack of transparent layers: the resolved
+// keymap against a walk down the active layers, and what keeping the
+// resolved keymap current costs per layer change. Layer 0 defines every
+// key; each layer above it defines a single key and is transparent
+// everywhere else, and all of them are on.
+#include <time.h>
+#include "test.h"
+#include "keycodes.h"
+#include "layers.h"
+#include "keymap_tables.h"
+
+#define POSITIONS (MATRIX_ROWS * KEYMAP_COLS)
+#define LAYERS MAX_LAYERS
+
+// Layer L > 0 defines position L - 1 only
+#define CELL(layer, p) ((layer) == 0 ? KC_A + (p) : ((p) == (layer) - 1 ? KC_1 : KC_TRNS))
+#define DEFINED(p) (1u | ((p) < LAYERS - 1 ? 1u << ((p) + 1) : 0))
+
+#define ROW(X, a, row) { \
+    X(a, (row) * 12 + 0), X(a, (row) * 12 + 1), X(a, (row) * 12 + 2), X(a, (row) * 12 + 3), \
+    X(a, (row) * 12 + 4), X(a, (row) * 12 + 5), X(a, (row) * 12 + 6), X(a, (row) * 12 + 7), \
+    X(a, (row) * 12 + 8), X(a, (row) * 12 + 9), X(a, (row) * 12 + 10), X(a, (row) * 12 + 11) }
+#define GRID(X, a) { ROW(X, a, 0), ROW(X, a, 1), ROW(X, a, 2), ROW(X, a, 3) }
+#define DEFINED_CELL(unused, p) DEFINED(p)
+
+#define LAYER(n) GRID(CELL, n),
+#define REPEAT4(X, n)  X(n) X((n) + 1) X((n) + 2) X((n) + 3)
+#define REPEAT32(X)    REPEAT4(X, 0) REPEAT4(X, 4) REPEAT4(X, 8) REPEAT4(X, 12) \
+                       REPEAT4(X, 16) REPEAT4(X, 20) REPEAT4(X, 24) REPEAT4(X, 28)
+
+_Static_assert(KEYMAP_COLS == 12 && MATRIX_ROWS == 4, "Bench keymap is written for 4 x 12");
+_Static_assert(MAX_LAYERS == 32, "Bench keymap is written for 32 layers");
+
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] = { REPEAT32(LAYER) };
+const uint8_t keymap_layer_count = LAYERS;
+const keymap_defined_t keymap_defined_layers = { .layers = GRID(DEFINED_CELL, 0) };
+
+#define LOOKUPS 4096
+#define ROUNDS 2000
+
+static uint8_t rows[LOOKUPS];
+static uint8_t cols[LOOKUPS];
+
+// The lookup before the resolved keymap: every active layer from the top
+// down until one is not transparent
+static uint16_t walk_down(layer_state_t active, uint8_t row, uint8_t col) {
+    for (int8_t layer = LAYERS - 1; layer >= 0; layer--) {
+        if (!(active & ((layer_state_t)1 << layer))) continue;
+        uint16_t keycode = keymaps[layer][row][col];
+        if (keycode != KC_TRNS) return keycode;
+    }
+    return KC_TRNS;
+}
+
+// Nothing to report to
+void send_hid_report(void) {
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void) {
+    layers_init();
+    for (uint8_t layer = 1; layer < LAYERS; layer++) layer_on(layer);
+    layer_state_t active = get_layer_state() | get_default_layer_state();
+    CHECK_EQ(active, 0xFFFFFFFFu);
+    
+    uint32_t state = 1;
+    for (int i = 0; i < LOOKUPS; i++) {
+        state = state * 1103515245u + 12345u;
+        uint8_t p = (state >> 8) % POSITIONS;
+        rows[i] = p / KEYMAP_COLS;
+        cols[i] = p % KEYMAP_COLS;
+        CHECK_EQ(get_resolved_keycode(rows[i], cols[i]), walk_down(active, rows[i], cols[i]));
+    }
+    
+    volatile uint32_t sink = 0;
+    uint64_t start = now_ns();
+    for (int round = 0; round < ROUNDS; round++) {
+        uint32_t sum = 0;
+        for (int i = 0; i < LOOKUPS; i++) sum += walk_down(active, rows[i], cols[i]);
+        sink += sum;
+    }
+    double walk_ns = (double)(now_ns() - start) / ((double)ROUNDS * LOOKUPS);
+    
+    start = now_ns();
+    for (int round = 0; round < ROUNDS; round++) {
+        uint32_t sum = 0;
+        for (int i = 0; i < LOOKUPS; i++) sum += get_resolved_keycode(rows[i], cols[i]);
+        sink += sum;
+    }
+    double resolved_ns = (double)(now_ns() - start) / ((double)ROUNDS * LOOKUPS);
+    
+    // The price of the cache: a momentary layer going on and off
+    enum { TOGGLES = 100000 };
+    start = now_ns();
+    for (int i = 0; i < TOGGLES; i++) {
+        uint8_t layer = 1 + i % (LAYERS - 1);
+        layer_off(layer);
+        layer_on(layer);
+    }
+    double toggle_ns = (double)(now_ns() - start) / (TOGGLES * 2.0);
+    (void)sink;
+    
+    for (int i = 0; i < LOOKUPS; i++) {
+        CHECK_EQ(get_resolved_keycode(rows[i], cols[i]), walk_down(active, rows[i], cols[i]));
+    }
+    
+    printf("%d layers on: walk %.2f ns/lookup, resolved %.2f ns/lookup\n",
+           LAYERS, walk_ns, resolved_ns);
+    printf("layer change: %.1f ns to update the resolved keymap\n", toggle_ns);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Multi-device simulation: per-packet cost of the dongle's receive path
+// (device lookup, replay window, matrix application) with 1 to 8 boards
+// typing at once, over a lossy link that reorders and duplicates packets
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "peripherals.h"
+#include "pipeline.h"
+
+#define PACKETS_PER_RUN 400000
+#define KEYS (MATRIX_ROWS * MATRIX_COLS)
+
+static uint32_t events[MAX_PERIPHERALS + 1];
+
+void pipeline_process_key(uint8_t row, uint8_t col, bool pressed, uint8_t device_id) {
+    events[device_id]++;
+}
+
+typedef struct {
+    uint8_t device_id;
+    uint16_t sequence;
+    matrix_state_t matrix;
+} packet_t;
+
+typedef struct {
+    uint16_t sequence;
+    matrix_state_t state;
+} sender_t;
+
+static packet_t packets[PACKETS_PER_RUN];
+
+static packet_t next_packet(sender_t *sender, uint8_t device_id, int key) {
+    packet_t packet = { .device_id = device_id, .sequence = sender->sequence++ };
+    uint8_t row = key / MATRIX_COLS;
+    uint8_t bit = 1 << (key % MATRIX_COLS);
+    
+    sender->state.rows[row] ^= bit;
+    packet.matrix = sender->state;
+    memset(packet.matrix.changed_mask, 0, sizeof(packet.matrix.changed_mask));
+    packet.matrix.changed_mask[row] = bit;
+    return packet;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void run(uint8_t devices) {
+    static sender_t senders[MAX_PERIPHERALS + 1];
+    
+    memset(senders, 0, sizeof(senders));
+    memset(events, 0, sizeof(events));
+    peripherals_init();
+    
+    // Round-robin traffic, each board starting its count somewhere else
+    for (uint8_t id = 1; id <= devices; id++) {
+        senders[id].sequence = (uint16_t)(id * 9973);
+    }
+    for (int i = 0; i < PACKETS_PER_RUN; i++) {
+        uint8_t id = 1 + i % devices;
+        packets[i] = next_packet(&senders[id], id, (i / devices) % KEYS);
+    }
+    
+    // Now and then a board's packet overtakes the one it sent before it
+    for (int i = 0; i + devices < PACKETS_PER_RUN; i += 7 * devices) {
+        packet_t swap = packets[i];
+        packets[i] = packets[i + devices];
+        packets[i + devices] = swap;
+    }
+    
+    uint32_t accepted = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < PACKETS_PER_RUN; i++) {
+        for (int copy = 0; copy < (i % 11 == 0 ? 2 : 1); copy++) {
+            const packet_t *packet = &packets[i];
+            peripheral_t *peripheral = peripheral_get(packet->device_id);
+            replay_result_t result = replay_window_check(&peripheral->window, packet->sequence);
+            if (!replay_window_accepted(result)) continue;
+            
+            peripheral_apply_matrix(peripheral, &packet->matrix, packet->sequence,
+                                    result == REPLAY_LATE);
+            accepted++;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+    
+    // Every packet applied once and every toggle delivered
+    CHECK_EQ(accepted, PACKETS_PER_RUN);
+    for (uint8_t id = 1; id <= devices; id++) {
+        CHECK_EQ(events[id], PACKETS_PER_RUN / devices);
+    }
+    
+    printf("%u device(s): %7.1f ns/packet\n", devices, (double)elapsed / PACKETS_PER_RUN);
+}
+
+int main(void) {
+    CHECK_EQ(peripheral_count(), 8);
+    for (uint8_t devices = 1; devices <= 8; devices *= 2) {
+        run(devices);
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+// Eight peripherals for the multi-device benchmark. The keymap is only
+// KEYMAP_COLS wide, so the boards share its columns in pairs.
+static const peripheral_config_t peripheral_configs[] = {
+    { 1, "Board 1", "192.168.4.2", MATRIX_ROWS, MATRIX_COLS, 0 },
+    { 2, "Board 2", "192.168.4.3", MATRIX_ROWS, MATRIX_COLS, MATRIX_COLS },
+    { 3, "Board 3", "192.168.4.4", MATRIX_ROWS, MATRIX_COLS, 0 },
+    { 4, "Board 4", "192.168.4.5", MATRIX_ROWS, MATRIX_COLS, MATRIX_COLS },
+    { 5, "Board 5", "192.168.4.6", MATRIX_ROWS, MATRIX_COLS, 0 },
+    { 6, "Board 6", "192.168.4.7", MATRIX_ROWS, MATRIX_COLS, MATRIX_COLS },
+    { 7, "Board 7", "192.168.4.8", MATRIX_ROWS, MATRIX_COLS, 0 },
+    { 8, "Board 8", "192.168.4.9", MATRIX_ROWS, MATRIX_COLS, MATRIX_COLS },
+};
@@ -0,0 +1,131 @@
+// Tap dance cost per event, built once per MAX_TAP_DANCE value: typing
+// on other keys, which used to scan every tap dance slot, and complete
+// dances through the tap-hold engine. Dances are spread over the whole
+// index range. The slot scan the old code ran on every other key is timed
+// alongside for comparison.
+#include <time.h>
+#include "test.h"
+#include "keycodes.h"
+#include "tapdance.h"
+#include "tap_hold.h"
+#include "layers.h"
+#include "pipeline.h"
+#include "deadline.h"
+#include "timer.h"
+#include "keymap_tables.h"
+
+#define POSITIONS (MATRIX_ROWS * KEYMAP_COLS)
+#define DANCE_KEYS 8  // Row 0, columns 0-7
+#define DANCE_AT(k) TD((k) * (MAX_TAP_DANCE / DANCE_KEYS))
+
+_Static_assert(MAX_TAP_DANCE % DANCE_KEYS == 0 && MAX_TAP_DANCE <= 256,
+               "Bench spreads 8 dance keys evenly over MAX_TAP_DANCE");
+
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] = {
+    {
+        { DANCE_AT(0), DANCE_AT(1), DANCE_AT(2), DANCE_AT(3), DANCE_AT(4), DANCE_AT(5),
+          DANCE_AT(6), DANCE_AT(7), KC_I, KC_O, KC_P, KC_BSPC },
+        { KC_A, KC_S, KC_D, KC_F, KC_G, KC_H, KC_J, KC_K, KC_L, KC_SCLN, KC_QUOT, KC_ENT },
+        { KC_Z, KC_X, KC_C, KC_V, KC_B, KC_N, KC_M, KC_COMM, KC_DOT, KC_SLSH, KC_1, KC_2 },
+        { KC_3, KC_4, KC_5, KC_6, KC_7, KC_8, KC_9, KC_0, KC_SPC, KC_TAB, KC_ESC, KC_GRV },
+    }
+};
+const uint8_t keymap_layer_count = 1;
+const keymap_defined_t keymap_defined_layers = {
+    .layers = { [0 ... MATRIX_ROWS - 1] = { [0 ... KEYMAP_COLS - 1] = 1 } }
+};
+
+const tap_dance_action_t tap_dance_actions[MAX_TAP_DANCE] = {
+    [0 ... MAX_TAP_DANCE - 1] = { .kc_single = KC_Q, .kc_double = KC_W }
+};
+const uint8_t tap_dance_count = MAX_TAP_DANCE < 256 ? MAX_TAP_DANCE : 255;  // 8-bit count
+
+// Keys the dances and typing put out
+static uint32_t keys_registered;
+
+void register_key(uint16_t keycode) {
+    (void)keycode;
+    keys_registered++;
+}
+
+void unregister_key(uint16_t keycode) {
+    (void)keycode;
+}
+
+void send_hid_report(void) {
+}
+
+static pipeline_result_t sink_stage(key_event_t *event) {
+    if (event->pressed) register_key(event->keycode);
+    return PIPELINE_CONSUMED;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void key(uint8_t position, bool pressed) {
+    pipeline_process_key(position / KEYMAP_COLS, position % KEYMAP_COLS, pressed, 1);
+}
+
+// What the old process_tap_dance did for every key that was not a dance
+static struct {
+    uint8_t count;
+} old_slots[MAX_TAP_DANCE];
+
+static void old_slot_scan(void) {
+    for (int i = 0; i < MAX_TAP_DANCE; i++) {
+        if (old_slots[i].count > 0) old_slots[i].count = 0;
+    }
+}
+
+int main(void) {
+    deadline_init();
+    layers_init();
+    pipeline_init();
+    tap_hold_init();
+    tap_hold_set_stage(pipeline_register("taphold", process_tap_hold, PIPELINE_ALL_KEYS));
+    pipeline_register("sink", sink_stage, PIPELINE_ALL_KEYS);
+    
+    // Typing on the keys that are not dances
+    enum { TAPS = 200000 };
+    uint64_t start = now_ns();
+    for (int i = 0; i < TAPS; i++) {
+        uint8_t position = DANCE_KEYS + (i * 7) % (POSITIONS - DANCE_KEYS);
+        key(position, true);
+        key(position, false);
+    }
+    double typing_ns = (double)(now_ns() - start) / (TAPS * 2.0);
+    CHECK_EQ(keys_registered, TAPS);
+    
+    start = now_ns();
+    for (int i = 0; i < TAPS * 2; i++) {
+        old_slot_scan();
+        __asm__ volatile("" ::: "memory");
+    }
+    double scan_ns = (double)(now_ns() - start) / (TAPS * 2.0);
+    
+    // Single and double taps on every dance key, each decided by its term
+    enum { DANCES = 20000 };
+    keys_registered = 0;
+    start = now_ns();
+    for (int i = 0; i < DANCES; i++) {
+        uint8_t position = i % DANCE_KEYS;
+        uint8_t taps = 1 + i % 2;
+        for (uint8_t t = 0; t < taps; t++) {
+            key(position, true);
+            key(position, false);
+        }
+        timer_virtual_advance_us(TIMER_MS_TO_US(TAP_DANCE_TERM) + 1000);
+        deadline_task();
+    }
+    uint32_t dance_events = DANCES / 2 * 2 + DANCES / 2 * 4;
+    double dance_ns = (double)(now_ns() - start) / dance_events;
+    CHECK_EQ(keys_registered, DANCES);
+    
+    printf("MAX_TAP_DANCE %d: typing %.1f ns/event (old slot scan alone %.1f ns), "
+           "dances %.1f ns/event\n", MAX_TAP_DANCE, typing_ns, scan_ns, dance_ns);
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+// Host stand-in for the Pico SDK header - the host build uses the virtual
+// clock from timer.h instead
+
+#endif // PICO_STDLIB_H
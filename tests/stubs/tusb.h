@@ -0,0 +1,32 @@
+#ifndef TUSB_H
+#define TUSB_H
+
+// Host stand-in for the TinyUSB device API the HID code uses. The calls
+// are implemented by tests/support/fake_usb.c, which plays the host.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+enum {
+    HID_PROTOCOL_BOOT = 0,
+    HID_PROTOCOL_REPORT = 1
+};
+
+bool tud_mounted(void);
+bool tud_hid_n_ready(uint8_t instance);
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len);
+bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modifier,
+                               uint8_t const keycode[6]);
+
+// Callbacks the application implements
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
+void tud_hid_set_protocol_cb(uint8_t instance, uint8_t protocol);
+
+#endif // TUSB_H
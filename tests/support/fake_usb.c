@@ -0,0 +1,115 @@
+#include <string.h>
+#include "tusb.h"
+#include "fake_usb.h"
+#include "timer.h"
+#include "test.h"
+
+host_report_t host_reports[FAKE_USB_MAX_REPORTS];
+int host_report_count = 0;
+
+static bool in_flight = false;
+
+static host_report_t *record(uint8_t report_id) {
+    CHECK(!in_flight);
+    CHECK(host_report_count < FAKE_USB_MAX_REPORTS);
+    in_flight = true;
+    
+    host_report_t *report = &host_reports[host_report_count++];
+    memset(report, 0, sizeof(*report));
+    report->time_us = timer_read_us();
+    report->report_id = report_id;
+    return report;
+}
+
+bool tud_mounted(void) {
+    return true;
+}
+
+bool tud_hid_n_ready(uint8_t instance) {
+    return instance == HID_ITF_KEYBOARD && !in_flight;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *data, uint16_t len) {
+    CHECK_EQ(instance, HID_ITF_KEYBOARD);
+    CHECK_EQ(report_id, REPORT_ID_NKRO);
+    CHECK_EQ(len, 1 + NKRO_REPORT_BYTES);
+    
+    const uint8_t *bytes = data;
+    host_report_t *report = record(report_id);
+    report->nkro = true;
+    report->modifiers = bytes[0];
+    memcpy(report->bits, bytes + 1, NKRO_REPORT_BYTES);
+    return true;
+}
+
+bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modifier,
+                               uint8_t const keycode[6]) {
+    CHECK_EQ(instance, HID_ITF_KEYBOARD);
+    
+    host_report_t *report = record(report_id);
+    report->modifiers = modifier;
+    memcpy(report->keycodes, keycode, 6);
+    return true;
+}
+
+void fake_usb_reset(void) {
+    host_report_count = 0;
+    in_flight = false;
+}
+
+void fake_usb_poll(void) {
+    if (!in_flight) return;
+    in_flight = false;
+    tud_hid_report_complete_cb(HID_ITF_KEYBOARD, NULL, 0);
+}
+
+void fake_usb_drain(void) {
+    for (int i = 0; i < FAKE_USB_MAX_REPORTS && !hid_report_queue_empty(); i++) {
+        send_hid_report();
+        fake_usb_poll();
+    }
+    fake_usb_poll();
+    CHECK(hid_report_queue_empty());
+}
+
+int host_edges(host_edge_t *edges, int max) {
+    static const host_report_t idle = {0};
+    int count = 0;
+    
+    for (int i = 0; i < host_report_count; i++) {
+        const host_report_t *before = (i == 0) ? &idle : &host_reports[i - 1];
+        const host_report_t *after = &host_reports[i];
+        
+        // Modifiers first, so a chord reads mod down, key down, key up, mod up
+        uint8_t mods_down = after->modifiers & ~before->modifiers;
+        uint8_t mods_up = before->modifiers & ~after->modifiers;
+        for (int bit = 0; bit < 8; bit++) {
+            if ((mods_down & (1 << bit)) && count < max) {
+                edges[count++] = (host_edge_t){ (uint8_t)(0xE0 + bit), true };
+            }
+        }
+        for (int usage = 1; usage < NKRO_REPORT_KEYS; usage++) {
+            bool was = host_report_has(before, usage);
+            bool is = host_report_has(after, usage);
+            if (was != is && count < max) {
+                edges[count++] = (host_edge_t){ (uint8_t)usage, is };
+            }
+        }
+        for (int bit = 0; bit < 8; bit++) {
+            if ((mods_up & (1 << bit)) && count < max) {
+                edges[count++] = (host_edge_t){ (uint8_t)(0xE0 + bit), false };
+            }
+        }
+    }
+    return count;
+}
+
+bool host_report_has(const host_report_t *report, uint8_t hid_keycode) {
+    if (report->nkro) {
+        return (report->bits[hid_keycode >> 3] & (1 << (hid_keycode & 7))) != 0;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (report->keycodes[i] == hid_keycode) return true;
+    }
+    return false;
+}
@@ -0,0 +1,46 @@
+#ifndef FAKE_USB_H
+#define FAKE_USB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_hid.h"
+
+// The USB host side of the keyboard interface: records every report the
+// firmware submits and completes transfers when polled
+
+#define FAKE_USB_MAX_REPORTS 4096
+
+typedef struct {
+    uint32_t time_us;   // Virtual time of submission
+    uint8_t report_id;  // 0 for boot protocol reports
+    bool nkro;
+    uint8_t modifiers;
+    uint8_t keycodes[6];
+    uint8_t bits[NKRO_REPORT_BYTES];
+} host_report_t;
+
+extern host_report_t host_reports[FAKE_USB_MAX_REPORTS];
+extern int host_report_count;
+
+// Forget recorded reports and any transfer in flight
+void fake_usb_reset(void);
+
+// One IN token from the host: completes the report in flight, if any
+void fake_usb_poll(void);
+
+// Poll and submit until every queued report has reached the host
+void fake_usb_drain(void);
+
+// Whether a HID usage is down in a recorded report
+bool host_report_has(const host_report_t *report, uint8_t hid_keycode);
+
+// Press and release edges the host saw across the recorded reports, as
+// HID usages with modifiers at 0xE0-0xE7
+typedef struct {
+    uint8_t usage;
+    bool pressed;
+} host_edge_t;
+
+int host_edges(host_edge_t *edges, int max);
+
+#endif // FAKE_USB_H
@@ -0,0 +1,39 @@
+#include "keyboard.h"
+#include "config.h"
+#include "protocol.h"
+#include "features.h"
+#include "pipeline.h"
+#include "deadline.h"
+#include "timer.h"
+#include "usb_hid.h"
+#include "fake_usb.h"
+
+void keyboard_reset(void) {
+    init_features();
+    clear_keyboard();
+    fake_usb_drain();
+    fake_usb_reset();
+}
+
+static void keyboard_event(uint8_t row, uint8_t col, bool pressed) {
+    uint8_t device_id = (col < MATRIX_COLS) ? DEVICE_LEFT : DEVICE_RIGHT;
+    pipeline_process_key(row, col, pressed, device_id);
+    send_hid_report();
+}
+
+void keyboard_press(uint8_t row, uint8_t col) {
+    keyboard_event(row, col, true);
+}
+
+void keyboard_release(uint8_t row, uint8_t col) {
+    keyboard_event(row, col, false);
+}
+
+void keyboard_wait_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        timer_virtual_advance_us(1000);
+        deadline_task();
+        send_hid_report();
+        fake_usb_poll();
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The dongle's feature stack with the default keymap, driven the way the
+// main loop drives it, against the fake USB host
+
+// Start from the boot state: features initialised, nothing held, no
+// reports recorded
+void keyboard_reset(void);
+
+// Matrix transitions at keymap positions
+void keyboard_press(uint8_t row, uint8_t col);
+void keyboard_release(uint8_t row, uint8_t col);
+
+// Let time pass in 1 ms main loop passes: due deadlines run and the host
+// polls once per pass
+void keyboard_wait_ms(uint32_t ms);
+
+#endif // KEYBOARD_H
@@ -0,0 +1,5 @@
+// The mouse endpoint is not simulated in the HID-only tests
+#include "mouse.h"
+
+void mouse_task(void) {
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal assertions for the host tests - a failed check reports and
+// exits, so ctest sees a non-zero status
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long actual_ = (long long)(actual); \
+    long long expected_ = (long long)(expected); \
+    if (actual_ != expected_) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %lld, expected %lld\n", \
+                __FILE__, __LINE__, #actual, actual_, expected_); \
+        exit(1); \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    fn(); \
+    printf("ok %s\n", #fn); \
+} while (0)
+
+#endif // TEST_H
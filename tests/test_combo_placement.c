@@ -0,0 +1,132 @@
+// Combo placement when the variants run out part way through a combo, and
+// the position a fired combo's output is released at. Three layers hold
+// the same keys shifted by one position each, so every combo takes a
+// separate variant per layer.
+#include "test.h"
+#include "keycodes.h"
+#include "combos.h"
+#include "layers.h"
+#include "deadline.h"
+#include "timer.h"
+#include "keymap_tables.h"
+
+#define POSITIONS (MATRIX_ROWS * KEYMAP_COLS)
+#define KEY_AT(p) (KC_A + (p))
+#define SHIFTED(layer, p) KEY_AT(((p) + POSITIONS - (layer)) % POSITIONS)
+
+#define ROW_KEYS(layer, row) { \
+    SHIFTED(layer, (row) * 12 + 0), SHIFTED(layer, (row) * 12 + 1), SHIFTED(layer, (row) * 12 + 2), \
+    SHIFTED(layer, (row) * 12 + 3), SHIFTED(layer, (row) * 12 + 4), SHIFTED(layer, (row) * 12 + 5), \
+    SHIFTED(layer, (row) * 12 + 6), SHIFTED(layer, (row) * 12 + 7), SHIFTED(layer, (row) * 12 + 8), \
+    SHIFTED(layer, (row) * 12 + 9), SHIFTED(layer, (row) * 12 + 10), SHIFTED(layer, (row) * 12 + 11) }
+#define LAYER_KEYS(layer) { ROW_KEYS(layer, 0), ROW_KEYS(layer, 1), ROW_KEYS(layer, 2), ROW_KEYS(layer, 3) }
+
+_Static_assert(KEYMAP_COLS == 12 && MATRIX_ROWS == 4, "Test keymap is written for 4 x 12");
+
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] = {
+    LAYER_KEYS(0), LAYER_KEYS(1), LAYER_KEYS(2)
+};
+const uint8_t keymap_layer_count = 3;
+const keymap_defined_t keymap_defined_layers = {
+    .layers = { [0 ... MATRIX_ROWS - 1] = { [0 ... KEYMAP_COLS - 1] = 0x7 } }
+};
+
+// Fillers 0..MAX_COMBOS-2 take two variants each, on layers 0 and 1,
+// leaving two free for the last combo, which needs three
+#define FILLERS (MAX_COMBOS - 1)
+#define FILLER_A(n) ((n) % POSITIONS)
+#define FILLER_B(n) (((n) % POSITIONS + 1 + (n) / POSITIONS) % POSITIONS)
+#define FILLER_KEYS(n) { KEY_AT(FILLER_A(n)), KEY_AT(FILLER_B(n)) },
+#define FILLER_ENTRY(n) { filler_keys[n], 2, KC_F1, 0, 0x3 },
+
+#define REPEAT4(X, n)   X(n) X((n) + 1) X((n) + 2) X((n) + 3)
+#define REPEAT16(X, n)  REPEAT4(X, n) REPEAT4(X, (n) + 4) REPEAT4(X, (n) + 8) REPEAT4(X, (n) + 12)
+#define REPEAT64(X, n)  REPEAT16(X, n) REPEAT16(X, (n) + 16) REPEAT16(X, (n) + 32) REPEAT16(X, (n) + 48)
+#define REPEAT255(X)    REPEAT64(X, 0) REPEAT64(X, 64) REPEAT64(X, 128) \
+                        REPEAT16(X, 192) REPEAT16(X, 208) REPEAT16(X, 224) \
+                        REPEAT4(X, 240) REPEAT4(X, 244) REPEAT4(X, 248) \
+                        X(252) X(253) X(254)
+
+_Static_assert(MAX_COMBOS == 256 && COMBO_MAX_VARIANTS == 512,
+               "Test table is written for 256 combos and 512 variants");
+
+#define LAST_A 0
+#define LAST_B 24  // Never a filler pair, whose keys are at most 6 apart
+
+static const uint16_t filler_keys[FILLERS][2] = { REPEAT255(FILLER_KEYS) };
+static const uint16_t last_keys[] = { KEY_AT(LAST_A), KEY_AT(LAST_B) };
+
+const combo_t key_combos[MAX_COMBOS] = {
+    REPEAT255(FILLER_ENTRY)
+    { last_keys, 2, KC_F2, 0, 0 }
+};
+const uint16_t combo_count = MAX_COMBOS;
+
+// Stage behind the combos: records what comes out
+static key_event_t outputs[16];
+static int output_count;
+
+static pipeline_result_t sink_stage(key_event_t *event) {
+    if (output_count < 16) outputs[output_count++] = *event;
+    return PIPELINE_CONSUMED;
+}
+
+void send_hid_report(void) {
+}
+
+static void key(uint8_t position, bool pressed) {
+    pipeline_process_key(position / KEYMAP_COLS, position % KEYMAP_COLS, pressed, 1);
+}
+
+static void settle(void) {
+    timer_virtual_advance_us(TIMER_MS_TO_US(COMBO_TERM) + 1000);
+    deadline_task();
+}
+
+// The last combo fits on layers 0 and 1 but not 2, so it is left out
+// everywhere rather than firing on two of its three layers
+static void test_partial_combo_dropped(void) {
+    const combo_stats_t *stats = get_combo_stats();
+    CHECK_EQ(stats->variants, FILLERS * 2);
+    CHECK_EQ(stats->dropped, 1);
+    
+    output_count = 0;
+    key(LAST_A, true);
+    key(LAST_B, true);
+    key(LAST_A, false);
+    key(LAST_B, false);
+    settle();
+    
+    CHECK_EQ(output_count, 4);
+    for (int i = 0; i < output_count; i++) CHECK(!outputs[i].remapped);
+}
+
+// Released in the other order, the output still comes up where it went down
+static void test_release_at_press_position(void) {
+    output_count = 0;
+    key(FILLER_A(0), true);
+    key(FILLER_B(0), true);
+    key(FILLER_A(0), false);
+    key(FILLER_B(0), false);
+    settle();
+    
+    CHECK_EQ(output_count, 2);
+    CHECK(outputs[0].remapped && outputs[0].pressed);
+    CHECK(outputs[1].remapped && !outputs[1].pressed);
+    CHECK_EQ(outputs[0].keycode, KC_F1);
+    CHECK_EQ(outputs[1].row, outputs[0].row);
+    CHECK_EQ(outputs[1].col, outputs[0].col);
+}
+
+int main(void) {
+    deadline_init();
+    layers_init();
+    pipeline_init();
+    init_combos();
+    combos_set_stage(pipeline_register("combo", process_combo, PIPELINE_ALL_KEYS));
+    pipeline_register("sink", sink_stage, PIPELINE_ALL_KEYS);
+    
+    RUN_TEST(test_partial_combo_dropped);
+    RUN_TEST(test_release_at_press_position);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// A lone combo key is released from the combo buffer by its deadline, on
+// time when the main loop sleeps until the next deadline, and at most one
+// pass late when it only polls
+#include "test.h"
+#include "config.h"
+#include "keycodes.h"
+#include "usb_hid.h"
+#include "deadline.h"
+#include "timer.h"
+#include "fake_usb.h"
+#include "keyboard.h"
+
+#define HOME_ROW 1
+#define RIGHT_J 7  // Part of the J+K combo
+#define PRESSES 100
+
+static uint32_t rng_state = 7;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+// Main loop that sleeps until the next deadline
+static void sleep_loop(uint32_t duration_us) {
+    uint32_t end = timer_read_us() + duration_us;
+    
+    while (timer_before_us(timer_read_us(), end)) {
+        uint32_t wait = deadline_wait_us(end - timer_read_us());
+        timer_virtual_advance_us(wait);
+        deadline_task();
+        send_hid_report();
+        fake_usb_poll();
+    }
+}
+
+// Main loop that runs a pass on every millisecond tick
+static void polling_loop(uint32_t duration_us) {
+    uint32_t end = timer_read_us() + duration_us;
+    
+    while (timer_before_us(timer_read_us(), end)) {
+        timer_virtual_advance_us(1000 - timer_read_us() % 1000);
+        deadline_task();
+        send_hid_report();
+        fake_usb_poll();
+    }
+}
+
+// Time the host first saw J down
+static uint32_t j_reported_at(void) {
+    for (int i = 0; i < host_report_count; i++) {
+        if (host_report_has(&host_reports[i], qmk_to_hid(KC_J))) {
+            return host_reports[i].time_us;
+        }
+    }
+    CHECK(false);
+    return 0;
+}
+
+// Presses at random sub-millisecond offsets, each left alone past the term
+static void run_presses(bool sleeping, uint32_t *late_total, uint32_t *late_max) {
+    *late_total = 0;
+    *late_max = 0;
+    
+    for (int i = 0; i < PRESSES; i++) {
+        keyboard_reset();
+        timer_virtual_advance_us(next_random() % 1000);
+        uint32_t pressed_at = timer_read_us();
+        const deadline_stats_t *stats = get_deadline_stats();
+        uint32_t fired = stats->fired;
+        uint32_t late = stats->late_us_total;
+        
+        keyboard_press(HOME_ROW, RIGHT_J);
+        if (sleeping) {
+            sleep_loop(TIMER_MS_TO_US(COMBO_TERM + 10));
+        } else {
+            polling_loop(TIMER_MS_TO_US(COMBO_TERM + 10));
+        }
+        
+        // Exactly the combo deadline fired, and released J to the host
+        CHECK_EQ(stats->fired - fired, 1);
+        uint32_t late_us = stats->late_us_total - late;
+        uint32_t host_delay = j_reported_at() - pressed_at;
+        CHECK_EQ(host_delay, TIMER_MS_TO_US(COMBO_TERM) + late_us);
+        
+        *late_total += late_us;
+        if (late_us > *late_max) *late_max = late_us;
+        
+        keyboard_release(HOME_ROW, RIGHT_J);
+        keyboard_wait_ms(5);
+    }
+}
+
+static void test_sleeping_loop_is_on_time(void) {
+    uint32_t total, max;
+    run_presses(true, &total, &max);
+    printf("sleeping loop: lateness avg %u us, max %u us\n", total / PRESSES, max);
+    CHECK_EQ(max, 0);
+}
+
+static void test_polling_loop_within_one_pass(void) {
+    uint32_t total, max;
+    run_presses(false, &total, &max);
+    printf("1 ms polling loop: lateness avg %u us, max %u us\n", total / PRESSES, max);
+    CHECK(max < 1000);
+}
+
+int main(void) {
+    RUN_TEST(test_sleeping_loop_is_on_time);
+    RUN_TEST(test_polling_loop_within_one_pass);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Combos with the default keymap: keys bind to every position carrying
+// them, and only on the layers the combo is active on
+#include "test.h"
+#include "keycodes.h"
+#include "keymap_layout.h"
+#include "usb_hid.h"
+#include "combos.h"
+#include "fake_usb.h"
+#include "keyboard.h"
+
+// Default keymap positions
+#define POS_D_ROW 0
+#define POS_D_COL 3
+#define POS_F_COL 5
+#define POS_HOME_ROW 1
+#define POS_LEFT_J 3
+#define POS_LEFT_K 4
+#define POS_RIGHT_J 7
+#define POS_RIGHT_K 8
+#define POS_RAISE_ROW 3
+#define POS_RAISE_COL 7
+
+static void expect_tap_only(uint16_t keycode) {
+    host_edge_t edges[16];
+    int count = host_edges(edges, 16);
+    
+    CHECK_EQ(count, 2);
+    CHECK_EQ(edges[0].usage, qmk_to_hid(keycode));
+    CHECK(edges[0].pressed);
+    CHECK_EQ(edges[1].usage, qmk_to_hid(keycode));
+    CHECK(!edges[1].pressed);
+}
+
+static bool host_saw(uint16_t keycode) {
+    host_edge_t edges[64];
+    int count = host_edges(edges, 64);
+    for (int i = 0; i < count; i++) {
+        if (edges[i].usage == qmk_to_hid(keycode)) return true;
+    }
+    return false;
+}
+
+static void chord(uint8_t row, uint8_t col_a, uint8_t col_b) {
+    keyboard_press(row, col_a);
+    keyboard_press(row, col_b);
+    keyboard_wait_ms(5);
+    keyboard_release(row, col_a);
+    keyboard_release(row, col_b);
+    keyboard_wait_ms(50);
+}
+
+static void test_right_hand_jk(void) {
+    keyboard_reset();
+    chord(POS_HOME_ROW, POS_RIGHT_J, POS_RIGHT_K);
+    expect_tap_only(KC_ESC);
+}
+
+static void test_left_hand_jk(void) {
+    keyboard_reset();
+    chord(POS_HOME_ROW, POS_LEFT_J, POS_LEFT_K);
+    expect_tap_only(KC_ESC);
+}
+
+static void test_df_on_base(void) {
+    keyboard_reset();
+    chord(POS_D_ROW, POS_D_COL, POS_F_COL);
+    expect_tap_only(KC_TAB);
+}
+
+// On _RAISE the D and F positions carry other keys, so no TAB
+static void test_df_not_on_raise(void) {
+    keyboard_reset();
+    keyboard_press(POS_RAISE_ROW, POS_RAISE_COL);
+    chord(POS_D_ROW, POS_D_COL, POS_F_COL);
+    keyboard_release(POS_RAISE_ROW, POS_RAISE_COL);
+    keyboard_wait_ms(50);
+    
+    CHECK(!host_saw(KC_TAB));
+    CHECK(host_saw(KC_3));  // KC_HASH is shifted 3
+}
+
+// _RAISE leaves the left home row transparent, so J+K still reach ESC
+static void test_jk_through_transparent_raise(void) {
+    keyboard_reset();
+    keyboard_press(POS_RAISE_ROW, POS_RAISE_COL);
+    chord(POS_HOME_ROW, POS_LEFT_J, POS_LEFT_K);
+    keyboard_release(POS_RAISE_ROW, POS_RAISE_COL);
+    keyboard_wait_ms(50);
+    
+    CHECK(host_saw(KC_ESC));
+    CHECK(!host_saw(KC_J));
+}
+
+// A lone combo key is typed once the combo window closes
+static void test_lone_key_after_term(void) {
+    keyboard_reset();
+    keyboard_press(POS_HOME_ROW, POS_RIGHT_J);
+    keyboard_wait_ms(COMBO_TERM + 5);
+    keyboard_release(POS_HOME_ROW, POS_RIGHT_J);
+    keyboard_wait_ms(5);
+    expect_tap_only(KC_J);
+}
+
+static void test_every_combo_placed(void) {
+    keyboard_reset();
+    CHECK_EQ(get_combo_stats()->dropped, 0);
+    CHECK(get_combo_stats()->variants >= 7);
+}
+
+int main(void) {
+    RUN_TEST(test_every_combo_placed);
+    RUN_TEST(test_right_hand_jk);
+    RUN_TEST(test_left_hand_jk);
+    RUN_TEST(test_df_on_base);
+    RUN_TEST(test_df_not_on_raise);
+    RUN_TEST(test_jk_through_transparent_raise);
+    RUN_TEST(test_lone_key_after_term);
+    return 0;
+}
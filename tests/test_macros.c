@@ -0,0 +1,146 @@
+// Shortcut keycodes play exactly their own chord, stopping a macro lets
+// go of the keys it holds, and the playback rate in characters per second
+#include "test.h"
+#include "config.h"
+#include "keycodes.h"
+#include "usb_hid.h"
+#include "macro.h"
+#include "timer.h"
+#include "fake_usb.h"
+#include "keyboard.h"
+
+// Default keymap: MO(_RAISE) on the right thumb, shortcuts on _RAISE row 2
+#define RAISE_ROW 3
+#define RAISE_COL 7
+#define SHORTCUT_ROW 2
+#define CUT_COL 2
+#define COPY_COL 3
+#define PASTE_COL 4
+
+static void play_shortcut(uint8_t col) {
+    keyboard_reset();
+    keyboard_press(RAISE_ROW, RAISE_COL);
+    keyboard_press(SHORTCUT_ROW, col);
+    keyboard_wait_ms(5);
+    keyboard_release(SHORTCUT_ROW, col);
+    keyboard_release(RAISE_ROW, RAISE_COL);
+    keyboard_wait_ms(50);
+}
+
+static void expect_ctrl_chord(uint16_t keycode) {
+    host_edge_t edges[32];
+    int count = host_edges(edges, 32);
+    uint8_t ctrl = qmk_to_hid(KC_LCTL);
+    uint8_t key = qmk_to_hid(keycode);
+    
+    CHECK_EQ(count, 4);
+    CHECK_EQ(edges[0].usage, ctrl);
+    CHECK(edges[0].pressed);
+    CHECK_EQ(edges[1].usage, key);
+    CHECK(edges[1].pressed);
+    CHECK_EQ(edges[2].usage, key);
+    CHECK(!edges[2].pressed);
+    CHECK_EQ(edges[3].usage, ctrl);
+    CHECK(!edges[3].pressed);
+}
+
+static void test_copy(void) {
+    play_shortcut(COPY_COL);
+    expect_ctrl_chord(KC_C);
+}
+
+static void test_cut(void) {
+    play_shortcut(CUT_COL);
+    expect_ctrl_chord(KC_X);
+}
+
+static void test_paste(void) {
+    play_shortcut(PASTE_COL);
+    expect_ctrl_chord(KC_V);
+}
+
+// Keys still down from MACRO_OP_DOWN when a macro is stopped
+static void test_stop_releases_held_keys(void) {
+    static const uint8_t hold_keys[] = {
+        MACRO_DOWN(KC_A), MACRO_DOWN(KC_LSFT), MACRO_TAP(KC_B), MACRO_DELAY(1000),
+        MACRO_UP(KC_A), MACRO_OP_END
+    };
+    
+    keyboard_reset();
+    macro_play(hold_keys);
+    keyboard_wait_ms(20);
+    CHECK(is_key_pressed(KC_A));
+    CHECK(get_modifier_state() != 0);
+    
+    macro_stop();
+    fake_usb_drain();
+    
+    CHECK(!is_key_pressed(KC_A));
+    CHECK_EQ(get_modifier_state(), 0);
+    CHECK_EQ(get_key_count(), 0);
+    
+    const host_report_t *last = &host_reports[host_report_count - 1];
+    CHECK_EQ(last->modifiers, 0);
+    CHECK(!host_report_has(last, qmk_to_hid(KC_A)));
+}
+
+// A macro that ends with a key still down does not leave it stuck
+static void test_end_releases_held_keys(void) {
+    static const uint8_t leave_down[] = { MACRO_DOWN(KC_C), MACRO_OP_END };
+    
+    keyboard_reset();
+    macro_play(leave_down);
+    keyboard_wait_ms(20);
+    
+    CHECK(!macro_is_playing());
+    CHECK(!is_key_pressed(KC_C));
+}
+
+// A long string of taps at the default step, timed on the virtual clock
+// from the first to the last report the host receives
+#define THROUGHPUT_CHARS 200
+
+static void test_throughput(void) {
+    static uint8_t text[THROUGHPUT_CHARS * 2 + 1];
+    for (int i = 0; i < THROUGHPUT_CHARS; i++) {
+        text[i * 2] = MACRO_OP_TAP;
+        text[i * 2 + 1] = KC_A + i % 26;
+    }
+    text[THROUGHPUT_CHARS * 2] = MACRO_OP_END;
+    
+    keyboard_reset();
+    macro_play(text);
+    while (macro_is_playing()) keyboard_wait_ms(1);
+    keyboard_wait_ms(5);
+    
+    // Every character reached the host as its own press and release
+    host_edge_t edges[THROUGHPUT_CHARS * 2 + 8];
+    int count = host_edges(edges, THROUGHPUT_CHARS * 2 + 8);
+    CHECK_EQ(count, THROUGHPUT_CHARS * 2);
+    for (int i = 0; i < THROUGHPUT_CHARS; i++) {
+        CHECK_EQ(edges[i * 2].usage, qmk_to_hid(KC_A + i % 26));
+        CHECK(edges[i * 2].pressed);
+        CHECK(!edges[i * 2 + 1].pressed);
+    }
+    
+    uint32_t elapsed_us = host_reports[host_report_count - 1].time_us - host_reports[0].time_us;
+    double cps = THROUGHPUT_CHARS * 1e6 / elapsed_us;
+    printf("%d characters in %.1f ms: %.0f characters/s at a %u us step\n",
+           THROUGHPUT_CHARS, elapsed_us / 1000.0, cps, MACRO_STEP_US);
+    
+    // Two steps per character, so one character per two steps when the
+    // host keeps up; the first and last report span one step less
+    double expected = 1e6 / (2.0 * MACRO_STEP_US);
+    CHECK(cps <= expected * 1.01);
+    CHECK(cps >= expected * 0.9);
+}
+
+int main(void) {
+    RUN_TEST(test_copy);
+    RUN_TEST(test_cut);
+    RUN_TEST(test_paste);
+    RUN_TEST(test_stop_releases_held_keys);
+    RUN_TEST(test_end_releases_held_keys);
+    RUN_TEST(test_throughput);
+    return 0;
+}
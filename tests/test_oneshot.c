@@ -0,0 +1,98 @@
+// One-shot modifiers with the default keymap: the armed modifier goes
+// with the next key and comes off when that key is released, including
+// when the next key is a combo released in either order
+#include "test.h"
+#include "keycodes.h"
+#include "usb_hid.h"
+#include "features.h"
+#include "fake_usb.h"
+#include "keyboard.h"
+
+// Default keymap positions
+#define POS_RAISE_ROW 3
+#define POS_RAISE_COL 7    // MO(_RAISE) on the base layer
+#define POS_ADJUST_COL 2   // MO(_ADJUST) on _RAISE
+#define POS_OSM_ROW 2
+#define POS_OSM_COL 11     // OSM(MOD_RSFT) on _ADJUST
+#define POS_HOME_ROW 1
+#define POS_RIGHT_J 7      // J and K form the ESC combo
+#define POS_RIGHT_K 8
+#define POS_TOP_ROW 0
+#define POS_A_COL 0
+
+#define MOD_BIT_RSFT 0x20
+
+// Reach _ADJUST through _RAISE and tap the one-shot right shift there
+static void tap_oneshot_shift(void) {
+    keyboard_press(POS_RAISE_ROW, POS_RAISE_COL);
+    keyboard_press(POS_RAISE_ROW, POS_ADJUST_COL);
+    keyboard_press(POS_OSM_ROW, POS_OSM_COL);
+    keyboard_release(POS_OSM_ROW, POS_OSM_COL);
+    keyboard_release(POS_RAISE_ROW, POS_ADJUST_COL);
+    keyboard_release(POS_RAISE_ROW, POS_RAISE_COL);
+    keyboard_wait_ms(5);
+    
+    CHECK_EQ(get_oneshot_mods(), MOD_BIT_RSFT);
+}
+
+static void expect_shift_cleared(void) {
+    CHECK_EQ(get_modifier_state(), 0);
+    CHECK(!is_oneshot_active());
+    
+    // The next key goes out unshifted
+    keyboard_press(POS_TOP_ROW, POS_A_COL);
+    keyboard_wait_ms(5);
+    keyboard_release(POS_TOP_ROW, POS_A_COL);
+    keyboard_wait_ms(5);
+    fake_usb_drain();
+    
+    CHECK_EQ(get_modifier_state(), 0);
+    CHECK(host_report_count > 0);
+    CHECK_EQ(host_reports[host_report_count - 1].modifiers, 0);
+}
+
+static void test_oneshot_on_plain_key(void) {
+    keyboard_reset();
+    tap_oneshot_shift();
+    
+    keyboard_press(POS_TOP_ROW, POS_A_COL);
+    keyboard_wait_ms(5);
+    CHECK_EQ(get_modifier_state(), MOD_BIT_RSFT);
+    keyboard_release(POS_TOP_ROW, POS_A_COL);
+    keyboard_wait_ms(5);
+    
+    expect_shift_cleared();
+}
+
+static void combo_with_oneshot(uint8_t first_up, uint8_t second_up) {
+    keyboard_reset();
+    tap_oneshot_shift();
+    
+    keyboard_press(POS_HOME_ROW, POS_RIGHT_J);
+    keyboard_press(POS_HOME_ROW, POS_RIGHT_K);
+    keyboard_wait_ms(5);
+    CHECK_EQ(get_modifier_state(), MOD_BIT_RSFT);
+    CHECK(is_key_pressed(KC_ESC));
+    
+    keyboard_release(POS_HOME_ROW, first_up);
+    keyboard_release(POS_HOME_ROW, second_up);
+    keyboard_wait_ms(50);
+    
+    expect_shift_cleared();
+}
+
+static void test_oneshot_on_combo(void) {
+    combo_with_oneshot(POS_RIGHT_K, POS_RIGHT_J);
+}
+
+// The combo output is pressed at K, the last key down; J comes up first
+static void test_oneshot_on_combo_released_in_reverse(void) {
+    combo_with_oneshot(POS_RIGHT_J, POS_RIGHT_K);
+}
+
+int main(void) {
+    RUN_TEST(test_oneshot_on_plain_key);
+    RUN_TEST(test_oneshot_on_combo);
+    RUN_TEST(test_oneshot_on_combo_released_in_reverse);
+    return 0;
+}
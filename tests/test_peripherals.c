@@ -0,0 +1,187 @@
+// Matrix updates from a peripheral reach the pipeline exactly once and in
+// order, whatever the network does to the packets
+#include <string.h>
+#include "test.h"
+#include "peripherals.h"
+#include "pipeline.h"
+
+#define KEYS (MATRIX_ROWS * MATRIX_COLS)
+
+// Pipeline stand-in: counts edges per key and checks they alternate
+static uint16_t presses[KEYS];
+static uint16_t releases[KEYS];
+static bool down[KEYS];
+
+void pipeline_process_key(uint8_t row, uint8_t col, bool pressed, uint8_t device_id) {
+    CHECK(col < MATRIX_COLS);
+    int key = row * MATRIX_COLS + col;
+    CHECK(down[key] != pressed);
+    down[key] = pressed;
+    if (pressed) presses[key]++; else releases[key]++;
+}
+
+// Sender side: full matrix snapshot plus the keys changed since its last packet
+typedef struct {
+    uint16_t sequence;
+    matrix_state_t matrix;
+} packet_t;
+
+static matrix_state_t sender_state;
+
+static packet_t make_packet(uint16_t sequence, int key, bool pressed) {
+    packet_t packet = { .sequence = sequence };
+    uint8_t row = key / MATRIX_COLS;
+    uint8_t bit = 1 << (key % MATRIX_COLS);
+    
+    if (pressed) sender_state.rows[row] |= bit; else sender_state.rows[row] &= ~bit;
+    packet.matrix = sender_state;
+    memset(packet.matrix.changed_mask, 0, sizeof(packet.matrix.changed_mask));
+    packet.matrix.changed_mask[row] = bit;
+    return packet;
+}
+
+// Receiver side, as the dongle's packet handler does it
+static void deliver(peripheral_t *peripheral, const packet_t *packet) {
+    replay_result_t result = replay_window_check(&peripheral->window, packet->sequence);
+    if (replay_window_accepted(result)) {
+        peripheral_apply_matrix(peripheral, &packet->matrix, packet->sequence,
+                                result == REPLAY_LATE);
+    }
+}
+
+static peripheral_t *setup(void) {
+    memset(presses, 0, sizeof(presses));
+    memset(releases, 0, sizeof(releases));
+    memset(down, 0, sizeof(down));
+    memset(&sender_state, 0, sizeof(sender_state));
+    peripherals_init();
+    peripheral_t *peripheral = peripheral_get(DEVICE_LEFT);
+    CHECK(peripheral != NULL);
+    return peripheral;
+}
+
+// A half that reconnects with its count far past 32768 still types
+static void test_reconnect_with_high_sequence(void) {
+    peripheral_t *peripheral = setup();
+    packet_t packet;
+    
+    packet = make_packet(5, 0, true);
+    deliver(peripheral, &packet);
+    packet = make_packet(6, 0, false);
+    deliver(peripheral, &packet);
+    
+    peripheral_reset(peripheral);
+    packet = make_packet(40000, 0, true);
+    deliver(peripheral, &packet);
+    packet = make_packet(40001, 0, false);
+    deliver(peripheral, &packet);
+    
+    CHECK_EQ(presses[0], 2);
+    CHECK_EQ(releases[0], 2);
+}
+
+// A key held while the count moves on by more than half the 16-bit range
+static void test_long_hold_across_wrap(void) {
+    peripheral_t *peripheral = setup();
+    packet_t packet;
+    uint16_t sequence = 100;
+    
+    packet = make_packet(sequence, 3, true);
+    deliver(peripheral, &packet);
+    
+    // Other keys and heartbeats carry the count around the wrap
+    for (int i = 0; i < 6; i++) {
+        sequence += 20000;
+        packet = make_packet(sequence, 7, i % 2 == 0);
+        deliver(peripheral, &packet);
+    }
+    
+    packet = make_packet(++sequence, 3, false);
+    deliver(peripheral, &packet);
+    
+    CHECK_EQ(presses[3], 1);
+    CHECK_EQ(releases[3], 1);
+    CHECK(!down[3]);
+}
+
+// The release of a quick tap overtakes its press
+static void test_release_before_press(void) {
+    peripheral_t *peripheral = setup();
+    packet_t press = make_packet(1, 4, true);
+    packet_t release = make_packet(2, 4, false);
+    
+    deliver(peripheral, &release);
+    CHECK_EQ(presses[4], 1);
+    CHECK_EQ(releases[4], 1);
+    
+    deliver(peripheral, &press);
+    CHECK_EQ(presses[4], 1);
+    CHECK(!down[4]);
+}
+
+// A press and release arriving after a newer packet for another key are
+// still applied in order
+static void test_late_tap_behind_newer_packet(void) {
+    peripheral_t *peripheral = setup();
+    packet_t press = make_packet(1, 2, true);
+    packet_t release = make_packet(2, 2, false);
+    packet_t other = make_packet(3, 9, true);
+    
+    deliver(peripheral, &other);
+    deliver(peripheral, &press);
+    CHECK(down[2]);
+    deliver(peripheral, &release);
+    
+    CHECK_EQ(presses[2], 1);
+    CHECK_EQ(releases[2], 1);
+    CHECK(down[9]);
+}
+
+// Taps rolling over every key, reordered and duplicated in flight, across
+// the 16-bit wrap: each tap arrives exactly once
+static void test_shuffled_duplicated_stream(void) {
+    enum { TAPS_PER_KEY = 40, PACKETS = KEYS * TAPS_PER_KEY * 2 };
+    static packet_t sent[PACKETS];
+    static uint32_t order[PACKETS];
+    peripheral_t *peripheral = setup();
+    uint32_t rng = 99;
+    uint16_t sequence = 65000;
+    
+    for (int tap = 0; tap < KEYS * TAPS_PER_KEY; tap++) {
+        int key = tap % KEYS;
+        sent[tap * 2] = make_packet(sequence++, key, true);
+        sent[tap * 2 + 1] = make_packet(sequence++, key, false);
+    }
+    
+    // Delay each packet by up to 6 slots
+    for (int i = 0; i < PACKETS; i++) {
+        rng = rng * 1103515245u + 12345u;
+        uint32_t key = (uint32_t)i * 8 + (rng >> 16) % 48;
+        int j = i;
+        while (j > 0 && (order[j - 1] >> 16) > key) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = (key << 16) | (uint32_t)i;
+    }
+    
+    for (int i = 0; i < PACKETS; i++) {
+        const packet_t *packet = &sent[order[i] & 0xFFFF];
+        deliver(peripheral, packet);
+        if (i % 5 == 0) deliver(peripheral, packet);
+    }
+    
+    for (int key = 0; key < KEYS; key++) {
+        CHECK_EQ(presses[key], TAPS_PER_KEY);
+        CHECK_EQ(releases[key], TAPS_PER_KEY);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_reconnect_with_high_sequence);
+    RUN_TEST(test_long_hold_across_wrap);
+    RUN_TEST(test_release_before_press);
+    RUN_TEST(test_late_tap_behind_newer_packet);
+    RUN_TEST(test_shuffled_duplicated_stream);
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Replay window against shuffled, duplicated and wrapping sequence streams
+#include <string.h>
+#include "test.h"
+#include "replay_window.h"
+
+#define STREAM_LENGTH 1024
+#define MAX_DISPLACEMENT 24  // Reordering the window must absorb
+
+static uint32_t rng_state = 12345;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+// Sequences start..start+length-1, each delayed by up to MAX_DISPLACEMENT
+// slots: sorted on index plus a random delay
+static void build_shuffled(uint16_t *stream, int length, uint16_t start) {
+    static uint32_t keys[STREAM_LENGTH];
+    
+    for (int i = 0; i < length; i++) {
+        uint32_t key = (uint32_t)i + next_random() % MAX_DISPLACEMENT;
+        int j = i;
+        while (j > 0 && keys[j - 1] > key) {
+            keys[j] = keys[j - 1];
+            stream[j] = stream[j - 1];
+            j--;
+        }
+        keys[j] = key;
+        stream[j] = (uint16_t)(start + i);
+    }
+}
+
+static void test_in_order_and_duplicates(void) {
+    replay_window_t window;
+    replay_window_init(&window);
+    
+    CHECK_EQ(replay_window_check(&window, 10), REPLAY_NEW);
+    CHECK_EQ(replay_window_check(&window, 10), REPLAY_DUPLICATE);
+    CHECK_EQ(replay_window_check(&window, 11), REPLAY_NEW);
+    CHECK_EQ(replay_window_check(&window, 13), REPLAY_NEW);
+    CHECK_EQ(replay_window_check(&window, 12), REPLAY_LATE);
+    CHECK_EQ(replay_window_check(&window, 12), REPLAY_DUPLICATE);
+    CHECK_EQ(replay_window_check(&window, 13), REPLAY_DUPLICATE);
+    
+    // Past the back of the window, but not yet stale
+    CHECK_EQ(replay_window_check(&window, 13 + REPLAY_WINDOW_SIZE), REPLAY_NEW);
+    CHECK_EQ(replay_window_check(&window, 13), REPLAY_TOO_OLD);
+}
+
+// Every sequence of a shuffled stream that crosses the 16-bit wrap, each
+// delivered twice, is accepted exactly once and maps to the position its
+// distance from the first packet says it should
+static void test_shuffled_duplicated_wrapping(void) {
+    static uint16_t stream[STREAM_LENGTH];
+    static uint8_t accepted[STREAM_LENGTH];
+    uint16_t start = 65536 - STREAM_LENGTH / 2;
+    replay_window_t window;
+    
+    replay_window_init(&window);
+    memset(accepted, 0, sizeof(accepted));
+    build_shuffled(stream, STREAM_LENGTH, start);
+    
+    uint16_t first = stream[0];
+    CHECK_EQ(replay_window_check(&window, first), REPLAY_NEW);
+    uint32_t first_position = replay_window_position(&window, first);
+    CHECK(first_position != 0);
+    accepted[(uint16_t)(first - start)]++;
+    
+    for (int i = 1; i < STREAM_LENGTH; i++) {
+        for (int copy = 0; copy < 2; copy++) {
+            uint16_t sequence = stream[copy ? i - 1 : i];
+            replay_result_t result = replay_window_check(&window, sequence);
+            CHECK(result != REPLAY_TOO_OLD);
+            if (!replay_window_accepted(result)) continue;
+            
+            accepted[(uint16_t)(sequence - start)]++;
+            uint32_t expected = first_position + (uint32_t)(int16_t)(sequence - first);
+            CHECK_EQ(replay_window_position(&window, sequence), expected);
+        }
+    }
+    
+    for (int i = 0; i < STREAM_LENGTH; i++) {
+        CHECK_EQ(accepted[i], 1);
+    }
+}
+
+// Positions keep growing across many 16-bit wraps
+static void test_position_survives_wraps(void) {
+    replay_window_t window;
+    replay_window_init(&window);
+    
+    uint16_t sequence = 0;
+    CHECK_EQ(replay_window_check(&window, sequence), REPLAY_NEW);
+    uint32_t start = replay_window_position(&window, sequence);
+    
+    for (uint32_t i = 1; i <= 3 * 65536u; i++) {
+        sequence++;
+        CHECK_EQ(replay_window_check(&window, sequence), REPLAY_NEW);
+    }
+    CHECK_EQ(replay_window_position(&window, sequence), start + 3 * 65536u);
+}
+
+// A packet far behind the window is stale, whether an old copy or a peer
+// that restarted unannounced, and leaves the window where it was
+static void test_stale_does_not_move_window(void) {
+    replay_window_t window;
+    replay_window_init(&window);
+    
+    for (uint16_t sequence = 10000; sequence < 10100; sequence++) {
+        CHECK_EQ(replay_window_check(&window, sequence), REPLAY_NEW);
+    }
+    uint32_t position = replay_window_position(&window, 10099);
+    
+    CHECK_EQ(replay_window_check(&window, 10099 - REPLAY_STALE_DISTANCE + 1), REPLAY_TOO_OLD);
+    CHECK_EQ(replay_window_check(&window, 10099 - REPLAY_STALE_DISTANCE), REPLAY_STALE);
+    CHECK_EQ(replay_window_check(&window, 50), REPLAY_STALE);
+    CHECK_EQ(replay_window_check(&window, 50), REPLAY_STALE);
+    
+    CHECK_EQ(replay_window_check(&window, 10099), REPLAY_DUPLICATE);
+    CHECK_EQ(replay_window_check(&window, 10100), REPLAY_NEW);
+    CHECK_EQ(replay_window_position(&window, 10100), position + 1);
+}
+
+// Once restarted, a peer's new count is taken, and even the late packets
+// of its new run order after everything from before the restart
+static void test_restart_orders_after_old_run(void) {
+    replay_window_t window;
+    replay_window_init(&window);
+    
+    for (uint16_t sequence = 10000; sequence < 10100; sequence++) {
+        CHECK_EQ(replay_window_check(&window, sequence), REPLAY_NEW);
+    }
+    uint32_t old_position = replay_window_position(&window, 10099);
+    
+    replay_window_restart(&window);
+    CHECK_EQ(replay_window_check(&window, 50), REPLAY_NEW);
+    CHECK_EQ(replay_window_check(&window, 20), REPLAY_LATE);
+    CHECK(replay_window_position(&window, 20) > old_position);
+    CHECK(replay_window_position(&window, 50) > replay_window_position(&window, 20));
+}
+
+// After a restart the window takes any sequence again, at a position past
+// everything accepted before
+static void test_restart_keeps_positions_growing(void) {
+    replay_window_t window;
+    replay_window_init(&window);
+    
+    CHECK_EQ(replay_window_check(&window, 50000), REPLAY_NEW);
+    uint32_t before = replay_window_position(&window, 50000);
+    
+    replay_window_restart(&window);
+    CHECK_EQ(replay_window_check(&window, 3), REPLAY_NEW);
+    CHECK(replay_window_position(&window, 3) > before);
+    CHECK_EQ(replay_window_check(&window, 3), REPLAY_DUPLICATE);
+}
+
+int main(void) {
+    RUN_TEST(test_in_order_and_duplicates);
+    RUN_TEST(test_shuffled_duplicated_wrapping);
+    RUN_TEST(test_position_survives_wraps);
+    RUN_TEST(test_stale_does_not_move_window);
+    RUN_TEST(test_restart_orders_after_old_run);
+    RUN_TEST(test_restart_keeps_positions_growing);
+    return 0;
+}
@@ -0,0 +1,276 @@
+// Typing-streak taps for mod-taps: a typing trace replayed once with the
+// mod-tap on a key in modtap_streak_keys and once on a key that is not,
+// comparing press-to-report latency of the taps. Chords on unlisted keys
+// stay holds, and a long idle gap does not count as a streak.
+#include <stdlib.h>
+#include "test.h"
+#include "config.h"
+#include "keycodes.h"
+#include "modtap.h"
+#include "tap_hold.h"
+#include "layers.h"
+#include "pipeline.h"
+#include "usb_hid.h"
+#include "deadline.h"
+#include "timer.h"
+#include "keymap_tables.h"
+#include "fake_usb.h"
+
+#define HOME_ROW     1
+#define CTRL_ESC_COL 0  // CTL_T(KC_ESC), not listed
+#define A_COL        1
+#define S_COL        2
+#define LISTED_COL   3  // SFT_T(KC_F), listed
+#define UNLISTED_COL 7  // SFT_T(KC_J), not listed
+
+#define HID_LCTL 0xE0
+#define HID_LSFT 0xE1
+
+const uint16_t keymaps[][MATRIX_ROWS][KEYMAP_COLS] = {
+    {
+        { KC_Q, KC_W, KC_E, KC_R, KC_T, KC_NO, KC_NO, KC_Y, KC_U, KC_I, KC_O, KC_P },
+        { CTL_T(KC_ESC), KC_A, KC_S, SFT_T(KC_F), KC_G, KC_NO,
+          KC_NO, SFT_T(KC_J), KC_K, KC_L, KC_H, KC_N },
+        { KC_Z, KC_X, KC_C, KC_V, KC_B, KC_NO, KC_NO, KC_M, KC_COMM, KC_DOT, KC_SLSH, KC_NO },
+        { KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO },
+    }
+};
+const uint8_t keymap_layer_count = 1;
+const keymap_defined_t keymap_defined_layers = {
+    .layers = { [0 ... MATRIX_ROWS - 1] = { [0 ... KEYMAP_COLS - 1] = 1 } }
+};
+
+const uint16_t modtap_streak_keys[] = {
+    SFT_T(KC_F),
+    KC_NO
+};
+
+static pipeline_result_t basic_stage(key_event_t *event) {
+    if (event->pressed) {
+        register_key(event->keycode);
+    } else {
+        unregister_key(event->keycode);
+    }
+    return PIPELINE_CONSUMED;
+}
+
+static void reset(void) {
+    pipeline_init();
+    tap_hold_init();
+    layers_init();
+    tap_hold_set_stage(pipeline_register("taphold", process_tap_hold, PIPELINE_ALL_KEYS));
+    pipeline_register("basic", basic_stage, PIPELINE_ALL_KEYS);
+    clear_keyboard();
+    fake_usb_drain();
+    fake_usb_reset();
+}
+
+static void key(uint8_t col, bool pressed) {
+    pipeline_process_key(HOME_ROW, col, pressed, DEVICE_LEFT);
+    send_hid_report();
+}
+
+// Main loop passes on every millisecond tick
+static void run_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        timer_virtual_advance_us(1000);
+        deadline_task();
+        send_hid_report();
+        fake_usb_poll();
+    }
+}
+
+static void tap(uint8_t col, uint32_t hold_ms) {
+    key(col, true);
+    run_ms(hold_ms);
+    key(col, false);
+}
+
+// Typing trace: press-to-press intervals of 50-170 ms, so about
+// 40% of presses fall inside TAP_HOLD_STREAK_TERM of the previous one
+#define TRACE_LENGTH 600
+
+typedef struct {
+    bool modtap;  // The mod-tap under test, or a plain letter
+    uint8_t letter_col;
+    uint8_t hold_ms;
+    uint8_t interval_ms;
+} trace_step_t;
+
+static trace_step_t trace[TRACE_LENGTH];
+static const uint8_t letter_cols[] = { A_COL, S_COL, 4, 8, 9, 10 };
+
+static void build_trace(void) {
+    uint32_t state = 42;
+    for (int i = 0; i < TRACE_LENGTH; i++) {
+        state = state * 1103515245u + 12345u;
+        uint32_t r = state >> 8;
+        trace[i].modtap = (r % 5) == 0;
+        trace[i].letter_col = letter_cols[(r / 5) % 6];
+        trace[i].hold_ms = 25 + (r / 30) % 21;
+        trace[i].interval_ms = 50 + (r / 630) % 121;
+    }
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us, p50_us, p95_us, max_us;
+    uint32_t avg_us;
+    uint32_t shifted;  // Reports with a shift applied
+} latency_t;
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Replays the trace with the mod-tap at `modtap_col`, recording the time
+// from each of its presses to the first report carrying its tap
+static latency_t replay(uint8_t modtap_col, uint8_t tap_usage) {
+    static uint32_t samples[TRACE_LENGTH];
+    latency_t result = {0};
+    uint64_t total = 0;
+    
+    reset();
+    for (int i = 0; i < TRACE_LENGTH; i++) {
+        const trace_step_t *step = &trace[i];
+        int first_report = host_report_count;
+        uint32_t pressed_at = timer_read_us();
+        
+        tap(step->modtap ? modtap_col : step->letter_col, step->hold_ms);
+        run_ms(step->interval_ms - step->hold_ms);
+        
+        if (!step->modtap) continue;
+        for (int r = first_report; r < host_report_count; r++) {
+            if (host_report_has(&host_reports[r], tap_usage)) {
+                samples[result.count] = host_reports[r].time_us - pressed_at;
+                total += samples[result.count];
+                result.count++;
+                break;
+            }
+        }
+    }
+    for (int r = 0; r < host_report_count; r++) {
+        if (host_reports[r].modifiers) result.shifted++;
+    }
+    
+    qsort(samples, result.count, sizeof(samples[0]), compare_u32);
+    result.min_us = samples[0];
+    result.p50_us = samples[result.count / 2];
+    result.p95_us = samples[result.count * 95 / 100];
+    result.max_us = samples[result.count - 1];
+    result.avg_us = total / result.count;
+    return result;
+}
+
+static void print_latency(const char *name, const latency_t *latency) {
+    printf("%s: %u taps, min %u us, p50 %u us, p95 %u us, max %u us, avg %u us\n",
+           name, latency->count, latency->min_us, latency->p50_us, latency->p95_us,
+           latency->max_us, latency->avg_us);
+}
+
+static void test_trace_latency(void) {
+    uint32_t modtap_steps = 0;
+    for (int i = 0; i < TRACE_LENGTH; i++) modtap_steps += trace[i].modtap;
+    
+    latency_t listed = replay(LISTED_COL, KC_F);
+    latency_t unlisted = replay(UNLISTED_COL, KC_J);
+    print_latency("listed  ", &listed);
+    print_latency("unlisted", &unlisted);
+    
+    // Every press came out as a tap, never as shift
+    CHECK_EQ(listed.count, modtap_steps);
+    CHECK_EQ(unlisted.count, modtap_steps);
+    CHECK_EQ(listed.shifted, 0);
+    CHECK_EQ(unlisted.shifted, 0);
+    
+    // Unlisted taps wait for their release; listed ones mid streak do not
+    CHECK(unlisted.min_us >= TIMER_MS_TO_US(25));
+    CHECK_EQ(listed.min_us, 0);
+    CHECK(listed.p50_us <= unlisted.p50_us);
+    CHECK(listed.avg_us < unlisted.avg_us);
+    CHECK_EQ(listed.max_us, unlisted.max_us);
+}
+
+// Ctrl+A typed right after a letter on a mod-tap that is not listed
+static void test_unlisted_chord_holds(void) {
+    reset();
+    tap(S_COL, 30);
+    run_ms(10);
+    key(CTRL_ESC_COL, true);
+    run_ms(30);
+    tap(A_COL, 20);
+    run_ms(20);
+    key(CTRL_ESC_COL, false);
+    run_ms(20);
+    
+    host_edge_t edges[16];
+    int count = host_edges(edges, 16);
+    CHECK_EQ(count, 6);
+    CHECK_EQ(edges[2].usage, HID_LCTL);
+    CHECK(edges[2].pressed);
+    CHECK_EQ(edges[3].usage, KC_A);
+    CHECK(edges[3].pressed);
+    CHECK_EQ(edges[4].usage, KC_A);
+    CHECK(!edges[4].pressed);
+    CHECK_EQ(edges[5].usage, HID_LCTL);
+    CHECK(!edges[5].pressed);
+    for (int i = 0; i < count; i++) CHECK(edges[i].usage != KC_ESC);
+}
+
+// The same chord on the listed key is typing: F at once, then A
+static void test_listed_taps_mid_streak(void) {
+    reset();
+    tap(S_COL, 30);
+    run_ms(10);
+    uint32_t pressed_at = timer_read_us();
+    key(LISTED_COL, true);
+    CHECK_EQ(host_report_count, 3);
+    CHECK(host_report_has(&host_reports[2], KC_F));
+    CHECK_EQ(host_reports[2].time_us, pressed_at);
+    run_ms(30);
+    tap(A_COL, 20);
+    run_ms(20);
+    key(LISTED_COL, false);
+    run_ms(20);
+    
+    for (int r = 0; r < host_report_count; r++) CHECK_EQ(host_reports[r].modifiers, 0);
+}
+
+// A press 40 minutes after the previous one, past half the 32-bit clock,
+// is not mid streak
+static void test_long_idle_is_not_streak(void) {
+    reset();
+    tap(S_COL, 30);
+    run_ms(10);
+    timer_virtual_advance_us(TIMER_MS_TO_US(40u * 60 * 1000));
+    deadline_task();
+    
+    key(LISTED_COL, true);
+    run_ms(30);
+    tap(A_COL, 20);
+    run_ms(20);
+    key(LISTED_COL, false);
+    run_ms(20);
+    
+    host_edge_t edges[16];
+    int count = host_edges(edges, 16);
+    CHECK_EQ(count, 6);
+    CHECK_EQ(edges[2].usage, HID_LSFT);
+    CHECK(edges[2].pressed);
+    CHECK_EQ(edges[3].usage, KC_A);
+    for (int i = 0; i < count; i++) CHECK(edges[i].usage != KC_F);
+}
+
+int main(void) {
+    deadline_init();
+    usb_hid_init();
+    build_trace();
+    
+    RUN_TEST(test_trace_latency);
+    RUN_TEST(test_unlisted_chord_holds);
+    RUN_TEST(test_listed_taps_mid_streak);
+    RUN_TEST(test_long_idle_is_not_streak);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// NKRO keyboard report: every key of a 48-key rollover reaches the host,
+// and the boot protocol falls back to the 6KRO report
+#include <string.h>
+#include "test.h"
+#include "tusb.h"
+#include "usb_hid.h"
+#include "fake_usb.h"
+
+#define ROLLOVER_KEYS 48
+
+static uint16_t rollover_key(int i) {
+    return KC_A + i;
+}
+
+static const host_report_t *last_report(void) {
+    CHECK(host_report_count > 0);
+    return &host_reports[host_report_count - 1];
+}
+
+static void reset(void) {
+    clear_keyboard();
+    fake_usb_drain();
+    fake_usb_reset();
+}
+
+// Press 48 keys one after another, the host reading between presses
+static void test_rollover_reported_key_by_key(void) {
+    reset();
+    CHECK(is_nkro_active());
+    
+    for (int i = 0; i < ROLLOVER_KEYS; i++) {
+        register_key(rollover_key(i));
+        fake_usb_drain();
+        
+        const host_report_t *report = last_report();
+        CHECK(report->nkro);
+        for (int j = 0; j < ROLLOVER_KEYS; j++) {
+            CHECK_EQ(host_report_has(report, qmk_to_hid(rollover_key(j))), j <= i);
+        }
+    }
+    CHECK_EQ(get_key_count(), ROLLOVER_KEYS);
+    CHECK_EQ(host_report_count, ROLLOVER_KEYS);
+}
+
+// Press all 48 in one burst before the host polls
+static void test_rollover_reported_at_once(void) {
+    reset();
+    
+    for (int i = 0; i < ROLLOVER_KEYS; i++) {
+        register_key(rollover_key(i));
+    }
+    fake_usb_drain();
+    
+    const host_report_t *report = last_report();
+    CHECK_EQ(report->report_id, REPORT_ID_NKRO);
+    for (int i = 0; i < ROLLOVER_KEYS; i++) {
+        uint8_t usage = qmk_to_hid(rollover_key(i));
+        CHECK(usage != 0);
+        CHECK(host_report_has(report, usage));
+        CHECK(is_key_pressed(rollover_key(i)));
+    }
+    
+    for (int i = 0; i < ROLLOVER_KEYS; i++) {
+        unregister_key(rollover_key(i));
+    }
+    fake_usb_drain();
+    for (int i = 0; i < ROLLOVER_KEYS; i++) {
+        CHECK(!host_report_has(last_report(), qmk_to_hid(rollover_key(i))));
+    }
+    CHECK_EQ(get_key_count(), 0);
+}
+
+// Boot protocol: six keys in the boot report, refilled as keys are released
+static void test_boot_protocol_fallback(void) {
+    reset();
+    tud_hid_set_protocol_cb(HID_ITF_KEYBOARD, HID_PROTOCOL_BOOT);
+    CHECK(!is_nkro_active());
+    
+    for (int i = 0; i < 8; i++) {
+        register_key(rollover_key(i));
+    }
+    fake_usb_drain();
+    
+    const host_report_t *report = last_report();
+    CHECK(!report->nkro);
+    CHECK_EQ(report->report_id, 0);
+    for (int i = 0; i < 8; i++) {
+        CHECK_EQ(host_report_has(report, qmk_to_hid(rollover_key(i))), i < 6);
+    }
+    
+    // Releasing a reported key makes room for one that did not fit
+    unregister_key(rollover_key(0));
+    fake_usb_drain();
+    report = last_report();
+    CHECK(!host_report_has(report, qmk_to_hid(rollover_key(0))));
+    for (int i = 1; i < 7; i++) {
+        CHECK(host_report_has(report, qmk_to_hid(rollover_key(i))));
+    }
+    
+    // Back to report protocol: the full state is resent as a bitmap
+    tud_hid_set_protocol_cb(HID_ITF_KEYBOARD, HID_PROTOCOL_REPORT);
+    fake_usb_drain();
+    report = last_report();
+    CHECK(report->nkro);
+    for (int i = 1; i < 8; i++) {
+        CHECK(host_report_has(report, qmk_to_hid(rollover_key(i))));
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_rollover_reported_key_by_key);
+    RUN_TEST(test_rollover_reported_at_once);
+    RUN_TEST(test_boot_protocol_fallback);
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Report queue: back-to-back press/release pairs and fast rolls reach the
+// host as separate reports, in order, and a full queue folds losslessly
+// into its newest entry
+#include <string.h>
+#include "test.h"
+#include "timer.h"
+#include "usb_hid.h"
+#include "fake_usb.h"
+
+#define QUEUE_SIZE 32  // HID_REPORT_QUEUE_SIZE in usb_hid.c
+
+static int keys_down(const host_report_t *report) {
+    int count = 0;
+    for (int usage = 1; usage < NKRO_REPORT_KEYS; usage++) {
+        if (host_report_has(report, usage)) count++;
+    }
+    return count;
+}
+
+static void reset(void) {
+    clear_keyboard();
+    fake_usb_drain();
+    fake_usb_reset();
+}
+
+// Taps registered back to back, as mod-taps, combos and macros do, before
+// the host gets to poll even once
+static void test_taps_reach_host_in_order(void) {
+    enum { TAPS = QUEUE_SIZE / 2 };
+    reset();
+    uint32_t overflows = get_hid_report_stats()->overflows;
+    
+    for (int i = 0; i < TAPS; i++) {
+        register_key(KC_A + i);
+        unregister_key(KC_A + i);
+    }
+    fake_usb_drain();
+    
+    CHECK_EQ(host_report_count, TAPS * 2);
+    for (int i = 0; i < TAPS; i++) {
+        const host_report_t *press = &host_reports[i * 2];
+        const host_report_t *release = &host_reports[i * 2 + 1];
+        CHECK(host_report_has(press, qmk_to_hid(KC_A + i)));
+        CHECK_EQ(keys_down(press), 1);
+        CHECK_EQ(keys_down(release), 0);
+    }
+    CHECK_EQ(get_hid_report_stats()->overflows, overflows);
+}
+
+// A roll: every intermediate state is reported
+static void test_roll_keeps_intermediate_states(void) {
+    reset();
+    
+    register_key(KC_A);
+    register_key(KC_B);
+    unregister_key(KC_A);
+    register_key(KC_C);
+    unregister_key(KC_B);
+    unregister_key(KC_C);
+    fake_usb_drain();
+    
+    static const uint16_t expected[][2] = {
+        { KC_A, KC_NO }, { KC_A, KC_B }, { KC_B, KC_NO },
+        { KC_B, KC_C }, { KC_C, KC_NO }, { KC_NO, KC_NO },
+    };
+    CHECK_EQ(host_report_count, 6);
+    for (int i = 0; i < 6; i++) {
+        const host_report_t *report = &host_reports[i];
+        int count = 0;
+        for (int k = 0; k < 2; k++) {
+            if (expected[i][k] == KC_NO) continue;
+            CHECK(host_report_has(report, qmk_to_hid(expected[i][k])));
+            count++;
+        }
+        CHECK_EQ(keys_down(report), count);
+    }
+}
+
+// Modifier edges are states of their own too
+static void test_modifier_chord_in_order(void) {
+    reset();
+    
+    register_modifier(KC_LCTL);
+    register_key(KC_C);
+    unregister_key(KC_C);
+    unregister_modifier(KC_LCTL);
+    fake_usb_drain();
+    
+    CHECK_EQ(host_report_count, 4);
+    CHECK_EQ(host_reports[0].modifiers, 0x01);
+    CHECK_EQ(keys_down(&host_reports[0]), 0);
+    CHECK_EQ(host_reports[1].modifiers, 0x01);
+    CHECK(host_report_has(&host_reports[1], qmk_to_hid(KC_C)));
+    CHECK_EQ(host_reports[2].modifiers, 0x01);
+    CHECK_EQ(keys_down(&host_reports[2]), 0);
+    CHECK_EQ(host_reports[3].modifiers, 0);
+}
+
+// More states than the queue holds: the overflow is counted, what the host
+// sees stays in order and it ends on the final state
+static void test_overflow_folds_into_newest(void) {
+    enum { TAPS = QUEUE_SIZE };
+    reset();
+    uint32_t overflows = get_hid_report_stats()->overflows;
+    
+    for (int i = 0; i < TAPS; i++) {
+        register_key(KC_A + i);
+        unregister_key(KC_A + i);
+    }
+    register_key(KC_Z);
+    fake_usb_drain();
+    
+    CHECK(get_hid_report_stats()->overflows > overflows);
+    CHECK_EQ(host_report_count, QUEUE_SIZE);
+    
+    // The first entries are untouched press/release pairs
+    for (int i = 0; i < QUEUE_SIZE / 2 - 1; i++) {
+        CHECK(host_report_has(&host_reports[i * 2], qmk_to_hid(KC_A + i)));
+        CHECK_EQ(keys_down(&host_reports[i * 2 + 1]), 0);
+    }
+    
+    const host_report_t *last = &host_reports[host_report_count - 1];
+    CHECK_EQ(keys_down(last), 1);
+    CHECK(host_report_has(last, qmk_to_hid(KC_Z)));
+}
+
+// Taps spread over host polls never overflow
+static void test_sustained_typing_with_polling(void) {
+    enum { TAPS = 1000 };
+    reset();
+    uint32_t overflows = get_hid_report_stats()->overflows;
+    
+    for (int i = 0; i < TAPS; i++) {
+        uint16_t keycode = KC_A + i % 26;
+        register_key(keycode);
+        unregister_key(keycode);
+        
+        // Two USB intervals per tap, one report each: 500 taps/s at 1 kHz
+        for (int poll = 0; poll < 2; poll++) {
+            send_hid_report();
+            fake_usb_poll();
+        }
+    }
+    fake_usb_drain();
+    
+    CHECK_EQ(get_hid_report_stats()->overflows, overflows);
+    CHECK_EQ(host_report_count, TAPS * 2);
+    for (int i = 0; i < TAPS; i++) {
+        CHECK(host_report_has(&host_reports[i * 2], qmk_to_hid(KC_A + i % 26)));
+        CHECK_EQ(keys_down(&host_reports[i * 2 + 1]), 0);
+    }
+}
+
+// A state change goes out on the same main loop pass, not a frame later,
+// and its latency is counted from that submission
+static void test_submitted_without_waiting_for_frame(void) {
+    reset();
+    usb_hid_init();
+    
+    register_key(KC_Q);
+    send_hid_report();
+    CHECK_EQ(host_report_count, 1);
+    
+    timer_virtual_advance_us(250);
+    fake_usb_poll();
+    unregister_key(KC_Q);
+    send_hid_report();
+    CHECK_EQ(host_report_count, 2);
+    
+    timer_virtual_advance_us(900);
+    fake_usb_poll();
+    
+    const hid_latency_stats_t *stats = get_hid_latency_stats();
+    CHECK_EQ(stats->completions, 2);
+    CHECK_EQ(stats->latency_us_min, 250);
+    CHECK_EQ(stats->latency_us_max, 900);
+    CHECK_EQ(stats->latency_us_total, 1150);
+}
+
+int main(void) {
+    RUN_TEST(test_taps_reach_host_in_order);
+    RUN_TEST(test_roll_keeps_intermediate_states);
+    RUN_TEST(test_modifier_chord_in_order);
+    RUN_TEST(test_overflow_folds_into_newest);
+    RUN_TEST(test_sustained_typing_with_polling);
+    RUN_TEST(test_submitted_without_waiting_for_frame);
+    return 0;
+}